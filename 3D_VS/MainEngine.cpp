@@ -1,25 +1,118 @@
 #include "MainEngine.h"
 
+#include <algorithm>
 #include <iostream>
 #include <ostream>
 #include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/ext/matrix_transform.hpp>
-
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+
+#include "benchmarks.h"
+#include "bvh.h"
+#include "draw_list.h"
 #include "camera.h"
+#include "camera_path.h"
+#include "ecs.h"
+#include "frame_stats.h"
+#include "frustum_culling.h"
+#include "gl_state_cache.h"
+#include "gpu_profiler.h"
+#include "gpu_timer.h"
+#include "input.h"
+#include "job_system.h"
+#include "lod_selection.h"
 #include "shader_handler.h"
+#include "mesh.h"
+#include "mesh_converter.h"
+#include "occlusion_culling.h"
+#include "profiler.h"
+#include "render_target.h"
+#include "scene_components.h"
+#include "shader_library.h"
+#include "stream_buffer.h"
+#include "transform_hierarchy.h"
+#include "uniform_buffer.h"
 #define GLFW_INCLUDE_NONE
 
-const unsigned int SRC_WIDTH = 1280;
-const unsigned int SRC_HEIGHT = 800;
+// occluder triangles rasterized per frame at most, the nearest occluder is always drawn
+const size_t OCCLUDER_TRIANGLE_BUDGET = 16384;
+
+static bool setupBenchmarkScene(EngineConfig& config, CameraPath& path);
 
+// defined with the rest of the scene state below
+extern Camera camera;
 
 int MainEngine::launch() {
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	const auto launchBegin = std::chrono::steady_clock::now();
+	// the importer and the culling code never touch GL, so their benchmarks run without a window
+	if (config.benchImport > 0) {
+		benchmarkImport(config.benchImport);
+		return 0;
+	}
+	if (config.benchCull > 0) {
+		benchmarkCulling(config.benchCull);
+		return 0;
+	}
+	if (config.benchOcclusion) {
+		benchmarkOcclusion();
+		return 0;
+	}
+	if (config.benchLod > 0) {
+		benchmarkLod(config.benchLod);
+		return 0;
+	}
+	if (config.benchEcs > 0) {
+		benchmarkEcs(config.benchEcs);
+		return 0;
+	}
+	if (config.benchJobs > 0) {
+		benchmarkJobs(config.benchJobs);
+		return 0;
+	}
+	if (config.benchHierarchy > 0) {
+		benchmarkHierarchy(config.benchHierarchy);
+		return 0;
+	}
+	if (config.benchBvh > 0) {
+		if (config.benchBvh > 1) benchmarkBvh(config.benchBvh);
+		else for (unsigned int objects : { 100000u, 1000000u }) benchmarkBvh(objects);
+		return 0;
+	}
+
+	// a benchmark scene sets its options and camera path before anything is created from them
+	CameraPath cameraPath;
+	const bool benchmarking = !config.benchmarkScene.empty();
+	if (benchmarking && !setupBenchmarkScene(config, cameraPath)) return -1;
+
+	// --trace records the zones of the first traceFrames frames, startup included
+	PROFILE_THREAD("main");
+#ifdef ENABLE_PROFILER
+	if (!config.traceFile.empty()) Profiler::start();
+#else
+	if (!config.traceFile.empty()) std::cout << "ERROR::PROFILER::NOT_COMPILED_IN: build with ENABLE_PROFILER to record " << config.traceFile << std::endl;
+#endif
+
+	// headless runs keep the window hidden and draw into an offscreen target; with an EGL or OSMesa context
+	// and GLFW 3.4's null platform they need no display server at all, so llvmpipe on a CI node is enough
+	const bool offscreenContext = config.headless && (config.contextApi == "egl" || config.contextApi == "osmesa");
+#ifdef GLFW_PLATFORM_NULL
+	if (offscreenContext) glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+	if (!glfwInit()) {
+		std::cout << "Failed to initialize GLFW" << std::endl;
+		return -1;
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	if (config.headless) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	if (offscreenContext) glfwWindowHint(GLFW_CONTEXT_CREATION_API, config.contextApi == "egl" ? GLFW_EGL_CONTEXT_API : GLFW_OSMESA_CONTEXT_API);
 
 	auto window = glfwCreateWindow(SRC_WIDTH, SRC_HEIGHT, "OpenGL", NULL, NULL);
 	if (window == NULL) {
@@ -29,131 +122,281 @@ int MainEngine::launch() {
 	}
 	glfwMakeContextCurrent(window);
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-	glfwSetCursorPosCallback(window, mouseCallBack);
-
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	if (!config.headless && !benchmarking) glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		return -1;
 	}
+	if (enableParallelShaderCompile((GLADloadproc)glfwGetProcAddress)) std::cout << "Parallel shader compile enabled" << std::endl;
+
+	if (config.benchUniforms) {
+		benchmarkUniforms();
+		glfwTerminate();
+		return 0;
+	}
+	if (!config.benchMesh.empty()) {
+		benchmarkMeshLoad(config.benchMesh);
+		glfwTerminate();
+		return 0;
+	}
+	if (config.benchLayout > 0) {
+		benchmarkVertexLayouts(config.benchLayout);
+		glfwTerminate();
+		return 0;
+	}
+
+	// a scripted camera takes no input
+	std::unique_ptr<InputSystem> input;
+	if (!benchmarking) input = std::make_unique<InputSystem>(window, config.rawMouse);
+	std::unique_ptr<GpuProfiler> gpuProfiler;
+	if (Profiler::recording()) gpuProfiler = std::make_unique<GpuProfiler>();
+	// GPU zones still in flight are waited for once, then everything is written
+	const auto finishTrace = [&]() {
+		gpuProfiler->finish();
+		gpuProfiler.reset();
+		Profiler::stop();
+		Profiler::writeChromeTrace(config.traceFile);
+	};
 
 	glEnable(GL_DEPTH_TEST);
+	// reverse-Z puts the near plane at depth 1 and infinity at 0, in a 0..1 clip range, so the nearest surface wins
+	// with GL_GREATER against a clear to 0
+	if (config.reverseZ) {
+		glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+		glDepthFunc(GL_GREATER);
+		glClearDepth(0.0);
+		camera.SetReverseZ(true);
+	}
 	double deltaTime = 0, lastTime = 0;
+	double statsTime = 0;
+	unsigned int statsFrames = 0;
 
 	obj = start();
+	if (obj == NULL) {
+		gpuProfiler.reset();
+		input.reset();
+		glfwTerminate();
+		return -1;
+	}
+	std::cout << "Startup: " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launchBegin).count() << " ms" << std::endl;
+	// the simulation starts now, not at glfwInit, so loading is not caught up on
+	timestep = FixedTimestep(1.0 / std::max(1.f, config.simulationRate));
+	lastTime = glfwGetTime();
+
+	std::unique_ptr<RenderTarget> target;
+	if (config.headless) target = std::make_unique<RenderTarget>(SRC_WIDTH, SRC_HEIGHT, config.reverseZ ? GL_DEPTH_COMPONENT32F : GL_DEPTH_COMPONENT24);
+	const double headlessBegin = glfwGetTime();
+	unsigned int frame = 0;
+
+	// benchmark runs measure every frame after the warm-up, which holds the first pose of the path
+	if (benchmarking && config.benchmarkFrames == 0) config.benchmarkFrames = (unsigned int)std::ceil(cameraPath.duration() / timestep.step()) + 1;
+	const unsigned int frameLimit = benchmarking ? config.benchmarkWarmup + config.benchmarkFrames : config.headless ? config.headlessFrames : 0;
+	std::unique_ptr<GpuFrameTimer> gpuTimer;
+	if (benchmarking) gpuTimer = std::make_unique<GpuFrameTimer>();
+	FrameStats frameStats(config.benchmarkFrames);
+	const auto onGpuTime = [&frameStats](uint64_t recorded, double ms) { frameStats.setGpu((size_t)recorded, ms); };
 
 	while (!glfwWindowShouldClose(window)) {
+		if (frameLimit > 0 && frame == frameLimit) break;
+		PROFILE_ZONE("frame");
+		if (gpuProfiler) gpuProfiler->beginFrame();
+		const bool measured = benchmarking && frame >= config.benchmarkWarmup;
+		const auto frameBegin = std::chrono::steady_clock::now();
+		frame++;
 		const auto currentTime = glfwGetTime();
 		deltaTime = currentTime - lastTime;
 		lastTime = currentTime;
-
-		processInput(window, deltaTime);
-
+		// headless and benchmark frames advance one simulation step each, so every run sees the same frames
+		if (config.headless || benchmarking) deltaTime = timestep.step();
+
+		// benchmark scenes report their cost once per second, interactive runs their input latency
+		statsFrames++;
+		if (currentTime - statsTime >= 1.0) {
+			const InputSystem::Stats latency = input ? input->frameStats() : InputSystem::Stats();
+			if (config.benchInstances > 0) {
+				std::cout << drawCalls << " draw calls/frame, " << stateChanges << " state changes (" << redundantStateChanges << " redundant skipped), " << visibleObjects << " of " << config.benchInstances << " cubes visible, "
+					<< occludedObjects << " occluded, " << submittedTriangles << " triangles/frame (" << fullDetailTriangles << " at full detail), "
+					<< updatedTransforms << " transforms updated in " << transformMilliseconds << " ms, " << simulationSteps << " simulation steps ("
+					<< droppedSimulationSeconds * 1000.0 << " ms dropped), " << streamStalls << " stream buffer stalls, " << 1000.0 * (currentTime - statsTime) / statsFrames << " ms/frame" << std::endl;
+			}
+			// from the oldest event a frame consumed until that frame was presented
+			if (latency.frames > 0) {
+				std::cout << "Input to present: " << latency.totalMilliseconds / latency.frames << " ms (" << latency.maxMilliseconds << " max) over " << latency.frames << " frames" << std::endl;
+			}
+			simulationSteps = 0;
+			droppedSimulationSeconds = 0;
+			streamStalls = 0;
+			statsTime = currentTime;
+			statsFrames = 0;
+		}
+		drawCalls = 0;
+		stateChanges = redundantStateChanges = 0;
+		occludedObjects = 0;
+		submittedTriangles = fullDetailTriangles = 0;
+
+		if (benchmarking) {
+			const float pathTime = frame > config.benchmarkWarmup ? (float)((frame - 1 - config.benchmarkWarmup) * timestep.step()) : 0.f;
+			const CameraKey pose = cameraPath.sample(pathTime);
+			camera.SetPose(pose.position, pose.yaw, pose.pitch);
+		}
+		else processInput(window, *input, deltaTime);
+
+		// the simulation catches up to the current time in fixed steps, drawing blends its last two states
+		const unsigned int steps = timestep.advance(deltaTime);
+		for (unsigned int step = 0; step < steps; step++) {
+			PROFILE_ZONE("simulate");
+			simulate((float)timestep.step());
+		}
+		const FixedTimestep::Stats simulationStats = timestep.frameStats();
+		simulationSteps += simulationStats.steps;
+		droppedSimulationSeconds += simulationStats.droppedSeconds;
+
+		if (gpuTimer && measured) gpuTimer->begin(frameStats.frames(), onGpuTime);
+		if (target) target->bind();
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		update();
-
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		update(timestep.alpha());
+		if (measured) {
+			gpuTimer->end();
+			frameStats.addCpu(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameBegin).count());
+			gpuTimer->collect(onGpuTime);
+		}
+
+		{
+			PROFILE_ZONE("swap");
+			if (!config.headless) glfwSwapBuffers(window);
+			if (input) input->presented(glfwGetTime());
+			glfwPollEvents();
+		}
+		if (gpuProfiler && frame == config.traceFrames) finishTrace();
 	}
+	if (gpuProfiler) finishTrace();
 
+	if (target) {
+		glFinish();
+		const double ms = (glfwGetTime() - headlessBegin) * 1000.0;
+		std::cout << "Headless: " << frame << " frames in " << ms << " ms, " << ms / std::max(1u, frame) << " ms/frame on " << (const char*)glGetString(GL_RENDERER) << std::endl;
+		if (!config.dumpFrame.empty() && target->savePpm(config.dumpFrame)) std::cout << "Last frame written to " << config.dumpFrame << std::endl;
+	}
+	if (benchmarking) {
+		gpuTimer->collect(onGpuTime, true);
+		const FrameStats::Summary cpu = frameStats.cpuSummary(), gpu = frameStats.gpuSummary();
+		std::cout << "Benchmark " << config.benchmarkScene << ": " << frameStats.frames() << " frames after " << config.benchmarkWarmup << " warm-up frames, CPU p50 "
+			<< cpu.p50 << " ms p95 " << cpu.p95 << " ms p99 " << cpu.p99 << " ms, GPU p50 " << gpu.p50 << " ms p95 " << gpu.p95 << " ms p99 " << gpu.p99 << " ms" << std::endl;
+		if (frameStats.writeJson(config.benchmarkOutput, config.benchmarkScene, config.benchmarkWarmup, config.simulationRate, (const char*)glGetString(GL_RENDERER))) {
+			std::cout << "Frame times written to " << config.benchmarkOutput << std::endl;
+		}
+	}
 	clearObj();
+	gpuTimer.reset();
+	target.reset();
+	input.reset();
 
 	glfwTerminate();
 	return 0;
 }
 
+
+// options and camera path of a named benchmark scene; the grid scenes fly through the instancing grid built by
+// start(), which sits in front of the camera from z = -5 on
+static bool setupBenchmarkScene(EngineConfig& config, CameraPath& path) {
+	const std::string& scene = config.benchmarkScene;
+	if (scene == "cube") {
+		// one orbit of the regular scene, always facing its center
+		config.benchInstances = 0;
+		for (unsigned int key = 0; key <= 8; key++) {
+			const float angle = glm::radians(45.f * key);
+			path.add(CameraKey{ key * 1.f, glm::vec3(3.f * std::sin(angle), 0.f, 3.f * std::cos(angle)), -90.f - 45.f * key, 0.f });
+		}
+		return true;
+	}
+	if (scene == "grid" || scene == "grid-static" || scene == "grid-culled") {
+		config.benchInstances = 100000;
+		config.staticObjects = scene == "grid-static";
+		if (scene == "grid-culled") config.cullWithBvh = config.occlusion = true;
+		const unsigned int side = (unsigned int)std::ceil(std::cbrt((double)config.benchInstances));
+		const float depth = 1.5f * (side - 1), half = 0.5f * depth;
+		// in from the front, through the middle, a turn near the back and a look back from above
+		path.add(CameraKey{ 0.f, glm::vec3(0.f, 0.f, 3.f), -90.f, 0.f });
+		path.add(CameraKey{ 4.f, glm::vec3(0.f, 0.f, -5.f - 0.3f * depth), -90.f, 0.f });
+		path.add(CameraKey{ 8.f, glm::vec3(0.5f * half, 0.25f * half, -5.f - 0.7f * depth), -60.f, -10.f });
+		path.add(CameraKey{ 12.f, glm::vec3(half, half, -5.f - depth), 45.f, -20.f });
+		path.add(CameraKey{ 16.f, glm::vec3(0.f, 1.5f * half, -5.f - 1.2f * depth), 90.f, -30.f });
+		return true;
+	}
+	std::cout << "ERROR::BENCHMARK::UNKNOWN_SCENE: " << scene << " (cube, grid, grid-static or grid-culled)" << std::endl;
+	return false;
+}
+
 //Additional classes **********************************************************************************************
-class Cube {
-private:
-	std::vector<float> vertices;
-	std::vector<unsigned int> indices;
-	unsigned int VAO, EBO;
-	unsigned int VBO[2];
-	Shader shader;
-public:
-	Cube() : shader(Shader("vertex.glsl", "fragment.glsl")) {
-		std::vector<glm::vec3> colors = {
-		glm::vec3(1.0f, 0.0f, 0.0f),
-		glm::vec3(1.0f, 0.0f, 0.0f),
-		glm::vec3(1.0f, 0.0f, 0.0f),
-
-		glm::vec3(0.0f, 1.0f, 0.0f),
-		glm::vec3(0.0f, 1.0f, 0.0f),
-
-		glm::vec3(0.0f, 0.0f, 1.0f),
-		glm::vec3(0.0f, 0.0f, 1.0f),
-		glm::vec3(0.0f, 0.0f, 1.0f),
-		};
+// per-instance data streamed to the GPU each frame, matches the layout in instanced_vertex.glsl
+struct MeshInstance {
+	glm::mat4 model;
+	glm::vec4 color;
+};
 
-		vertices = {
-			-0.5f, -0.5f, -0.5f, // vertex 0
-			-0.5f, -0.5f, 0.5f, // vertex 1
-			-0.5f, 0.5f, -0.5f, // vertex 2
-			-0.5f, 0.5f, 0.5f, // vertex 3
-			0.5f, -0.5f, -0.5f, // vertex 4
-			0.5f, -0.5f, 0.5f, // vertex 5
-			0.5f, 0.5f, -0.5f, // vertex 6
-			0.5f, 0.5f, 0.5f // vertex 7
-		};
+// one chunk of drawable entities and the index of its first drawable, for jobs that take ranges of chunks
+struct DrawChunk {
+	uint32_t count;
+	uint32_t first;
+	SceneNode* nodes;
+	MeshRenderer* renderers;
+	Material* materials;
+};
 
-		indices = {
-			0, 1, 2, // front
-			1, 3, 2,
-			4, 0, 6, // back
-			6, 0, 2,
-			5, 4, 7, // right
-			4, 6, 7,
-			1, 5, 3, // left
-			5, 7, 3,
-			2, 3, 6, // top
-			3, 7, 6,
-			1, 0, 5, // bottom
-			0, 4, 5
-		};
+// one shared mesh drawn for many transforms: its program and a vertex array with the instance stream attached,
+// from which draw packets are recorded
+class InstancedMesh {
+public:
+	// vertex buffer binding of the per-instance stream, placed after every binding a mesh may use
+	static const GLuint INSTANCE_BINDING = MESH_MAX_STREAMS;
 
-		glGenVertexArrays(1, &VAO);
+private:
+	const Mesh& mesh;
+	unsigned int VAO;
+	Shader& shader;
+public:
+	InstancedMesh(ShaderLibrary& shaders, const Mesh& mesh) : mesh(mesh), shader(shaders.load("instanced_vertex.glsl", "fragment.glsl")) {
+		// the mesh streams plus an instance stream: model matrix as four vec4 columns at locations 3..6 and
+		// color at location 7; the buffer itself is a slice of the stream buffer, attached each frame on submit
+		VAO = mesh.createVertexArray();
 		glBindVertexArray(VAO);
+		for (unsigned int i = 0; i < 4; i++) {
+			glVertexAttribFormat(3 + i, 4, GL_FLOAT, GL_FALSE, (GLuint)(offsetof(MeshInstance, model) + i * sizeof(glm::vec4)));
+			glVertexAttribBinding(3 + i, INSTANCE_BINDING);
+			glEnableVertexAttribArray(3 + i);
+		}
+		glVertexAttribFormat(7, 4, GL_FLOAT, GL_FALSE, offsetof(MeshInstance, color));
+		glVertexAttribBinding(7, INSTANCE_BINDING);
+		glEnableVertexAttribArray(7);
+		glVertexBindingDivisor(INSTANCE_BINDING, 1);
+		glBindVertexArray(0);
+	}
 
-		glGenBuffers(1, &VBO[0]);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-
-		glGenBuffers(1, &VBO[1]);
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-		glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(glm::vec3), colors.data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(1);
-
-		glGenBuffers(1, &EBO);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-	}
-
-	void draw(const glm::mat4& projection, const glm::mat4& view) {
-		auto transform = glm::mat4(1.f);
-		transform = rotate(transform, (float)glfwGetTime() * glm::radians(45.f), glm::vec3(0.5, 0, 1.));
-		shader.use();
-		shader.setMat4("projection", projection);
-		shader.setMat4("view", view);
-		shader.setMat4("transform", transform);
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size() * sizeof(unsigned int), GL_UNSIGNED_INT, (void*)0);
+	InstancedMesh(const InstancedMesh&) = delete;
+	InstancedMesh& operator=(const InstancedMesh&) = delete;
+
+	// a packet drawing one level of detail at a depth in [0, 1), without instances yet; reads no GL state, so
+	// jobs may call it
+	DrawPacket packet(unsigned int lod, float depth = 0.f) const {
+		DrawPacket packet;
+		packet.key = makeDrawKey(DrawPass::Opaque, shader.ID, 0, VAO, lod, depth);
+		packet.program = shader.ID;
+		packet.vertexArray = VAO;
+		packet.indexType = mesh.indexType;
+		packet.indexCount = (GLsizei)mesh.lods[lod].indexCount;
+		packet.indexOffset = (uintptr_t)mesh.lodIndices(lod);
+		return packet;
 	}
-	
-	~Cube() {
+
+	~InstancedMesh() {
 		glDeleteVertexArrays(1, &VAO);
-		glDeleteBuffers(1, &VAO);
-		glDeleteBuffers(1, &EBO);
-		glDeleteBuffers(1, &VBO[0]);
-		glDeleteBuffers(1, &VBO[1]);
 	}
 };
+
 //Additional classes **********************************************************************************************
 
 
@@ -163,28 +406,376 @@ public:
 
 //Camera settings
 Camera camera = Camera(glm::vec3(0.f, 0.f, 3.f));
-bool firstMouse = true;
-float lastX = SRC_WIDTH / 2.f, lastY = SRC_HEIGHT / 2.f;
 
 
 struct FObj {
 
-	Cube* cube;
+	// every program used by the scene, declared first so it outlives the objects using it
+	ShaderLibrary shaders;
+
+	// worker threads for the per-frame CPU work; jobs never touch GL, which stays on this thread
+	JobSystem jobs;
+
+	// meshes referenced by MeshRenderer::mesh, GPU resident only, and the instanced renderer of each
+	std::vector<std::unique_ptr<Mesh>> meshes;
+	std::vector<std::unique_ptr<InstancedMesh>> renderers;
+
+	// single upload path for everything that changes per frame
+	StreamBuffer stream;
+
+	// view, projection and view-projection shared by every program, written once per frame
+	CameraUniformBuffer cameraBuffer;
+
+	// every object in the scene, and the parent/child placement of the ones with a SceneNode
+	World world;
+	TransformHierarchy transforms;
+
+	// world-space boxes of the drawable entities in iteration order, SoA for the culling batches, the entity
+	// and unscaled extent behind each box, the drawable of every hierarchy node (NONE for groups), the boxes
+	// that moved this frame and this frame's visible indices
+	CullBounds bounds;
+	std::vector<Entity> drawables;
+	std::vector<glm::vec3> extents;
+	std::vector<uint32_t> nodeToDrawable;
+	std::vector<uint32_t> moved;
+	Bvh bvh;
+	std::vector<uint32_t> visible;
+	std::vector<uint8_t> visibleFlags;
+
+	// software depth buffer filled with the nearest objects, and the scratch list they are picked from
+	OcclusionBuffer occlusion;
+	std::vector<uint32_t> occluders;
+
+	// this frame's drawable chunks, instances per mesh and level of detail (also per range of chunks, where
+	// they turn into each range's first instance, plus a copy each range advances as it writes), and the draw
+	// list every range records into
+	std::vector<DrawChunk> drawChunks;
+	std::vector<uint32_t> lodCounts;
+	std::vector<uint32_t> rangeCounts;
+	std::vector<uint32_t> rangeNext;
+	std::vector<DrawList> drawLists;
+	DrawSubmitter submitter;
+	GlStateCache glState;
+
+	explicit FObj(bool shaderCache) : shaders("shader_cache", shaderCache) {}
+};
 
-	~FObj() {
-		delete cube;
+// waits for the batch of compiles issued while building the scene, then reports the shader startup cost
+void MainEngine::finishShaders(ShaderLibrary& shaders) const {
+	shaders.finishPending();
+	if (config.hotReload) shaders.enableHotReload();
+	const auto& stats = shaders.statistics();
+	std::cout << "Shaders: " << stats.milliseconds << " ms, " << stats.compiled << " compiled, " << stats.fromBinary << " from binary cache, "
+		<< stats.deduplicated << " deduplicated, " << stats.rejectedBinaries << " rejected binaries" << std::endl;
+}
+
+// numbers the drawable entities in iteration order, which every per-frame pass relies on, so it has to run
+// again after entities are created or destroyed
+static void indexDrawables(FObj& obj) {
+	const size_t count = obj.world.count<SceneNode, Bounds, MeshRenderer, Material>();
+	obj.bounds.resize(count);
+	obj.drawables.resize(count);
+	obj.extents.resize(count);
+	obj.nodeToDrawable.assign(obj.transforms.size(), TransformHierarchy::NONE);
+	uint32_t next = 0;
+	obj.world.eachChunk<SceneNode, Bounds, MeshRenderer, Material>([&](uint32_t count, const Entity* entities, SceneNode* nodes, Bounds* boxes, MeshRenderer*, Material*) {
+		for (uint32_t row = 0; row < count; row++, next++) {
+			obj.drawables[next] = entities[row];
+			obj.extents[next] = boxes[row].extent;
+			obj.nodeToDrawable[nodes[row].node] = next;
+		}
+	});
+}
+
+// world-space boxes of the drawables whose world matrix the last hierarchy update recomputed, listed in moved
+static void updateBounds(FObj& obj) {
+	obj.moved.clear();
+	for (uint32_t node : obj.transforms.changed()) {
+		const uint32_t drawable = obj.nodeToDrawable[node];
+		if (drawable == TransformHierarchy::NONE) continue;
+		const glm::mat4& model = obj.transforms.world(node);
+		const float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		obj.bounds.set(drawable, glm::vec3(model[3]), obj.extents[drawable] * scale);
+		obj.moved.push_back(drawable);
 	}
-};
+}
 
 FObj* MainEngine::start() {
-	const auto Obj = new FObj{new Cube};
+	const auto Obj = new FObj(config.shaderCache);
+	const std::string meshPath = std::filesystem::path(config.sceneMesh).replace_extension(".vsmesh").string();
+	Obj->meshes.push_back(std::make_unique<Mesh>());
+	Mesh& mesh = *Obj->meshes.back();
+	// without its mesh the scene would draw nothing, and benchmarks would measure an empty frame
+	if (!ensureMeshFile(config.sceneMesh, meshPath) || !mesh.load(meshPath)) {
+		std::cout << "ERROR::ENGINE::SCENE_MESH_UNAVAILABLE: " << config.sceneMesh << std::endl;
+		delete Obj;
+		return nullptr;
+	}
+	const auto& stats = mesh.loadStats();
+	std::cout << "Mesh " << meshPath << ": " << stats.milliseconds << " ms, " << stats.gpuBytes << " bytes on the GPU, " << mesh.lodCount << " LODs" << std::endl;
+	Obj->renderers.push_back(std::make_unique<InstancedMesh>(Obj->shaders, mesh));
+	finishShaders(Obj->shaders);
+
+	// a box that holds the mesh in any orientation, since every object spins
+	const float meshRadius = glm::length(glm::max(glm::abs(mesh.boundsMin), glm::abs(mesh.boundsMax)));
+	const Bounds bounds = { glm::vec3(meshRadius) };
+	const glm::vec3 axis = glm::vec3(0.5f, 0.f, 1.f);
+	const float speed = glm::radians(45.f);
+
+	// a drawable object under the given hierarchy node; static objects get no Spin, so no system ever touches them
+	auto addObject = [&](const Transform& transform, float phase, const Material& material, uint32_t parent) {
+		Transform placed = transform;
+		if (!config.staticObjects) placed.angle = phase;
+		const SceneNode node = { Obj->transforms.add(localMatrix(placed), parent) };
+		if (config.staticObjects) Obj->world.create(node, placed, bounds, MeshRenderer{ 0, 0 }, material);
+		else Obj->world.create(node, placed, PreviousTransform{ placed }, Spin{ speed, phase }, bounds, MeshRenderer{ 0, 0 }, material);
+	};
+
+	if (config.benchInstances == 0) {
+		addObject(Transform{ glm::vec3(0.f), 0.f, axis, 1.f }, 0.f, Material{ glm::vec4(1.f) }, TransformHierarchy::NONE);
+	}
+	else {
+		Obj->stream.reserve(config.benchInstances * sizeof(MeshInstance) + (64 << 10));
+		// lay the cubes out in a grid in front of the camera, one group node per slice along z so moving a
+		// slice moves its cubes
+		const unsigned int side = (unsigned int)std::ceil(std::cbrt((double)config.benchInstances));
+		const float spacing = 1.5f;
+		const glm::vec3 origin = glm::vec3(-0.5f * spacing * (side - 1), -0.5f * spacing * (side - 1), -5.f - spacing * (side - 1));
+		uint32_t slice = TransformHierarchy::NONE;
+		for (unsigned int i = 0; i < config.benchInstances; i++) {
+			const glm::vec3 cell = glm::vec3(i % side, (i / side) % side, i / (side * side));
+			if (i % (side * side) == 0) {
+				const Transform group = { origin + glm::vec3(0.f, 0.f, cell.z * spacing), 0.f, axis, 1.f };
+				slice = Obj->transforms.add(localMatrix(group), TransformHierarchy::NONE);
+				Obj->world.create(SceneNode{ slice }, group);
+			}
+			const Material material = { glm::vec4(cell / (float)side * 0.75f + 0.25f, 1.f) };
+			addObject(Transform{ glm::vec3(cell.x, cell.y, 0.f) * spacing, 0.f, axis, 1.f }, i * 0.01f, material, slice);
+		}
+		std::cout << "Instancing benchmark: " << config.benchInstances << " cubes, " << (config.benchNoInstancing ? "one draw call per cube" : "instanced") << std::endl;
+	}
+
+	indexDrawables(*Obj);
+	Obj->transforms.update(&Obj->jobs);
+	updateBounds(*Obj);
+	if (config.cullWithBvh) {
+		const auto begin = std::chrono::steady_clock::now();
+		Obj->bvh.build(Obj->bounds);
+		std::cout << "BVH: " << Obj->bvh.size() << " nodes in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() << " ms" << std::endl;
+	}
 	return Obj;
 }
 
-void MainEngine::update() {
-	const glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SRC_WIDTH / (float)SRC_HEIGHT, 0.1f, 100.0f);
-	const glm::mat4 view = camera.GetViewMatrix();
-	obj->cube->draw(projection, view);
+// one fixed step of every simulated system; reads no clock, so objects move the same at any frame rate
+void MainEngine::simulate(float step) {
+	const float turn = glm::radians(360.f);
+	obj->world.each<Transform, PreviousTransform, Spin>([step, turn](Transform& transform, PreviousTransform& previous, const Spin& spin) {
+		previous.transform = transform;
+		transform.angle += spin.speed * step;
+		// kept within one turn for float precision, the previous angle moves along so blending stays short
+		const float wrap = transform.angle > turn ? turn : transform.angle < -turn ? -turn : 0.f;
+		transform.angle -= wrap;
+		previous.transform.angle -= wrap;
+	});
+}
+
+void MainEngine::update(float alpha) {
+	PROFILE_ZONE("update");
+	PROFILE_GPU_ZONE("update");
+	// a program swapped in by a hot reload may carry the name of the one the cache thinks is bound
+	if (obj->shaders.update()) obj->glState.invalidate();
+	// culling needs the projection before the camera block is written
+	camera.SetAspect((float)SRC_WIDTH / (float)SRC_HEIGHT);
+	World& world = obj->world;
+
+	// everything the simulation moves is drawn alpha of the way from its previous to its current state
+	TransformHierarchy& transforms = obj->transforms;
+	world.each<SceneNode, Transform, PreviousTransform>([&](const SceneNode& node, const Transform& transform, const PreviousTransform& previous) {
+		transforms.setLocal(node.node, localMatrix(interpolate(previous.transform, transform, alpha)));
+	});
+
+	// world matrices and boxes are only recomputed below the nodes that changed
+	{
+		PROFILE_ZONE("transforms");
+		transforms.update(&obj->jobs);
+		updatedTransforms = transforms.statistics().updated;
+		transformMilliseconds = transforms.statistics().milliseconds;
+		updateBounds(*obj);
+	}
+
+	// only what survives culling gets streamed and drawn
+	const Frustum& frustum = camera.GetFrustum();
+	{
+		PROFILE_ZONE("cull");
+		if (config.culling && config.cullWithBvh) {
+			// past a quarter of the objects one bottom-up pass is cheaper than walking every moved leaf's path
+			if (obj->moved.size() * 4 > obj->bounds.size()) obj->bvh.refit(obj->bounds);
+			else if (!obj->moved.empty()) obj->bvh.refit(obj->bounds, obj->moved);
+			obj->bvh.query(frustum, obj->bounds, obj->visible);
+		}
+		else if (config.culling) cullFrustum(frustum, obj->bounds, obj->visible, obj->jobs);
+		else {
+			obj->visible.resize(obj->bounds.size());
+			for (size_t i = 0; i < obj->visible.size(); i++) obj->visible[i] = (uint32_t)i;
+		}
+	}
+
+	// the nearest objects become occluders for everything behind them, drawn with their full detail triangles:
+	// simplified levels fill in concave regions and can stick out of the real silhouette, so only the real
+	// surface is safe. Nearest first, until a triangle budget is used up, so detailed meshes stay affordable.
+	// Only triangles facing the camera are drawn, so open meshes occlude from their front side only
+	if (config.occlusion && !obj->visible.empty()) {
+		PROFILE_ZONE("occlusion");
+		const size_t count = std::min<size_t>(64, obj->visible.size());
+		auto& occluders = obj->occluders;
+		occluders = obj->visible;
+		const auto distance = [&](uint32_t i) {
+			const glm::vec3 offset = glm::vec3(obj->bounds.centerX[i], obj->bounds.centerY[i], obj->bounds.centerZ[i]) - camera.GetPosition();
+			return glm::dot(offset, offset);
+		};
+		std::partial_sort(occluders.begin(), occluders.begin() + count, occluders.end(), [&](uint32_t a, uint32_t b) { return distance(a) < distance(b); });
+		obj->occlusion.begin(camera.GetCullingMatrix());
+		size_t triangles = 0;
+		for (size_t k = 0; k < count; k++) {
+			const Entity entity = obj->drawables[occluders[k]];
+			const Mesh& mesh = *obj->meshes[world.get<MeshRenderer>(entity)->mesh];
+			triangles += mesh.occluderIndices.size() / 3;
+			if (k > 0 && triangles > OCCLUDER_TRIANGLE_BUDGET) break;
+			obj->occlusion.addTriangles(transforms.world(world.get<SceneNode>(entity)->node), mesh.occluderPositions.data(), mesh.occluderPositions.size(), mesh.occluderIndices.data(), mesh.occluderIndices.size(), mesh.occluderAdjacency.data());
+		}
+		obj->occlusion.rasterize(&obj->jobs);
+		occludedObjects = (unsigned int)obj->occlusion.filter(obj->bounds, obj->visible);
+	}
+	visibleObjects = (unsigned int)obj->visible.size();
+
+	// visibility as one flag per drawable, so the passes below walk the chunks in order
+	obj->visibleFlags.assign(obj->bounds.size(), 0);
+	for (uint32_t i : obj->visible) obj->visibleFlags[i] = 1;
+
+	// the drawable chunks in iteration order with the index of their first drawable, so jobs can take ranges
+	auto& chunks = obj->drawChunks;
+	chunks.clear();
+	uint32_t firstDrawable = 0;
+	world.eachChunk<SceneNode, Bounds, MeshRenderer, Material>([&](uint32_t count, const Entity*, SceneNode* nodes, Bounds*, MeshRenderer* renderers, Material* materials) {
+		chunks.push_back(DrawChunk{ count, firstDrawable, nodes, renderers, materials });
+		firstDrawable += count;
+	});
+	JobSystem& jobs = obj->jobs;
+	const size_t keys = obj->meshes.size() * MESH_MAX_LODS;
+	const size_t grain = std::max<size_t>(1, (chunks.size() + jobs.threadCount() * 4 - 1) / (jobs.threadCount() * 4));
+	const size_t ranges = (chunks.size() + grain - 1) / grain;
+	auto& rangeCounts = obj->rangeCounts;
+	rangeCounts.assign(ranges * keys, 0);
+
+	// level of detail from the error each level would show on screen at the object's nearest distance, counted
+	// per range of chunks, mesh and level
+	const float pixelScale = lodPixelScale(camera.GetZoom(), (float)SRC_HEIGHT);
+	const CullBounds& bounds = obj->bounds;
+	jobs.parallelFor(chunks.size(), grain, [&](size_t begin, size_t end) {
+		PROFILE_ZONE("lod");
+		uint32_t* counts = &rangeCounts[begin / grain * keys];
+		for (size_t c = begin; c < end; c++) {
+			const DrawChunk& chunk = chunks[c];
+			for (uint32_t row = 0; row < chunk.count; row++) {
+				const uint32_t drawable = chunk.first + row;
+				if (!obj->visibleFlags[drawable]) continue;
+				MeshRenderer& renderer = chunk.renderers[row];
+				const Mesh& mesh = *obj->meshes[renderer.mesh];
+				if (config.lod) {
+					const glm::vec3 center = glm::vec3(bounds.centerX[drawable], bounds.centerY[drawable], bounds.centerZ[drawable]);
+					const glm::vec3 extent = glm::vec3(bounds.extentX[drawable], bounds.extentY[drawable], bounds.extentZ[drawable]);
+					const float distance = glm::length(center - camera.GetPosition()) - glm::length(extent);
+					renderer.lod = selectLod(mesh.lods, mesh.lodCount, distance, pixelScale, config.lodPixelError, renderer.lod);
+				}
+				else renderer.lod = 0;
+				counts[renderer.mesh * MESH_MAX_LODS + renderer.lod]++;
+			}
+		}
+	});
+
+	// every level of every mesh gets one contiguous run of instances, split between the ranges in range order;
+	// the counts turn into each range's first instance in place
+	auto& lodCounts = obj->lodCounts;
+	lodCounts.assign(keys, 0);
+	uint32_t total = 0;
+	for (size_t key = 0; key < keys; key++) {
+		for (size_t range = 0; range < ranges; range++) {
+			const uint32_t count = rangeCounts[range * keys + key];
+			rangeCounts[range * keys + key] = total;
+			total += count;
+			lodCounts[key] += count;
+		}
+	}
+	for (size_t m = 0; m < obj->meshes.size(); m++) {
+		const Mesh& mesh = *obj->meshes[m];
+		for (unsigned int lod = 0; lod < mesh.lodCount; lod++) {
+			submittedTriangles += (size_t)lodCounts[m * MESH_MAX_LODS + lod] * (mesh.lods[lod].indexCount / 3);
+			fullDetailTriangles += (size_t)lodCounts[m * MESH_MAX_LODS + lod] * (mesh.indexCount / 3);
+		}
+	}
+
+	// everything this frame uploads is known now, so a region too small for it grows before the camera block and
+	// the instances are written, instead of the frame being dropped
+	if (!obj->stream.beginFrame((GLsizeiptr)sizeof(CameraBlock) + (GLsizeiptr)(total + 1) * sizeof(MeshInstance))) return;
+	if (obj->stream.recreated()) obj->glState.invalidate();
+	obj->cameraBuffer.update(camera, (float)SRC_WIDTH / (float)SRC_HEIGHT, obj->stream);
+
+	// jobs write their instances straight into the stream buffer and record packets into their own draw list;
+	// the packets of one level from consecutive ranges cover consecutive instances, so the submitter merges
+	// them back into one draw
+	const auto slice = total > 0 ? obj->stream.allocate(total * sizeof(MeshInstance), sizeof(MeshInstance)) : StreamBuffer::Allocation();
+	if (slice) {
+		MeshInstance* instances = (MeshInstance*)slice.data;
+		const bool instanced = !config.benchNoInstancing;
+		obj->drawLists.resize(ranges);
+		obj->rangeNext.resize(ranges * keys);
+		jobs.parallelFor(chunks.size(), grain, [&](size_t begin, size_t end) {
+			PROFILE_ZONE("instances");
+			const uint32_t* first = &rangeCounts[begin / grain * keys];
+			uint32_t* next = &obj->rangeNext[begin / grain * keys];
+			std::copy(first, first + keys, next);
+			DrawList& list = obj->drawLists[begin / grain];
+			list.clear();
+			for (size_t c = begin; c < end; c++) {
+				const DrawChunk& chunk = chunks[c];
+				for (uint32_t row = 0; row < chunk.count; row++) {
+					if (!obj->visibleFlags[chunk.first + row]) continue;
+					const MeshRenderer& renderer = chunk.renderers[row];
+					const uint32_t index = next[renderer.mesh * MESH_MAX_LODS + renderer.lod]++;
+					instances[index].model = transforms.world(chunk.nodes[row].node);
+					instances[index].color = chunk.materials[row].color;
+					// the comparison path draws every object on its own, front to back
+					if (!instanced) {
+						const uint32_t drawable = chunk.first + row;
+						const float distance = glm::length(glm::vec3(bounds.centerX[drawable], bounds.centerY[drawable], bounds.centerZ[drawable]) - camera.GetPosition());
+						DrawPacket packet = obj->renderers[renderer.mesh]->packet(renderer.lod, distance / (distance + 1.f));
+						packet.firstInstance = index;
+						packet.instanceCount = 1;
+						list.add(packet);
+					}
+				}
+			}
+			if (!instanced) return;
+			for (size_t key = 0; key < keys; key++) {
+				if (next[key] == first[key]) continue;
+				// no depth, so the pieces of one level keep their range order and merge again
+				DrawPacket packet = obj->renderers[key / MESH_MAX_LODS]->packet((unsigned int)(key % MESH_MAX_LODS));
+				packet.firstInstance = first[key];
+				packet.instanceCount = (GLsizei)(next[key] - first[key]);
+				list.add(packet);
+			}
+		});
+		const InstanceStream stream = { obj->stream.ID, slice.offset, (GLsizei)sizeof(MeshInstance), InstancedMesh::INSTANCE_BINDING };
+		PROFILE_ZONE("submit");
+		PROFILE_GPU_ZONE("submit");
+		drawCalls += obj->submitter.submit(obj->drawLists, stream, obj->glState, instanced).drawCalls;
+	}
+
+	const GlStateCache::Stats state = obj->glState.frameStats();
+	stateChanges += state.programChanges + state.vertexArrayChanges + state.bufferChanges;
+	redundantStateChanges += state.skipped;
+	obj->stream.endFrame();
+	streamStalls += obj->stream.stalledFrames();
 }
 
 void MainEngine::clearObj() {
@@ -200,31 +791,18 @@ void MainEngine::framebufferSizeCallback(GLFWwindow* window, int width, int heig
 	glViewport(0, 0, width, height);
 }
 
-void MainEngine::mouseCallBack(GLFWwindow* windows, double xposIn, double yposIn) {
-	auto xpos = static_cast<float>(xposIn);
-	auto ypos = static_cast<float>(yposIn);
-
-	if (firstMouse) {
-		lastX = xpos;
-		lastY = ypos;
-		firstMouse = false;
-	}
-
-	float xoffset = xpos - lastX;
-	float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
-
-	lastX = xpos;
-	lastY = ypos;
-
-	camera.ProcessMouseMovement(xoffset, yoffset);
-}
 //end of callbacks
 
-void MainEngine::processInput(GLFWwindow* window, double deltaTime) const {
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) glfwSetWindowShouldClose(window, true);
-
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) camera.ProcessKeyboard(FORWARD, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) camera.ProcessKeyboard(BACKWARD, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) camera.ProcessKeyboard(LEFT, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) camera.ProcessKeyboard(RIGHT, deltaTime);
+// everything queued since the last frame, applied to the camera in one go
+void MainEngine::processInput(GLFWwindow* window, InputSystem& input, double deltaTime) const {
+	PROFILE_ZONE("input");
+	input.beginFrame();
+	if (input.pressed(InputAction::Quit)) glfwSetWindowShouldClose(window, true);
+
+	if (input.held(InputAction::MoveForward)) camera.ProcessKeyboard(FORWARD, deltaTime);
+	if (input.held(InputAction::MoveBackward)) camera.ProcessKeyboard(BACKWARD, deltaTime);
+	if (input.held(InputAction::MoveLeft)) camera.ProcessKeyboard(LEFT, deltaTime);
+	if (input.held(InputAction::MoveRight)) camera.ProcessKeyboard(RIGHT, deltaTime);
+	if (input.mouseX() != 0.f || input.mouseY() != 0.f) camera.ProcessMouseMovement(input.mouseX(), input.mouseY());
+	if (input.scroll() != 0.f) camera.ProcessMouseScroll(input.scroll());
 }
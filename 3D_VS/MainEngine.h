@@ -2,21 +2,118 @@
 #ifndef MAINENGINE_H
 #define MAINENGINE_H
 
+#include <string>
+
+#include "fixed_timestep.h"
+
 class GLFWwindow;
+class InputSystem;
+class ShaderLibrary;
 struct FObj;
 
+// window size, also the aspect the benchmarks project with
+const unsigned int SRC_WIDTH = 1280;
+const unsigned int SRC_HEIGHT = 800;
+
+struct EngineConfig {
+	// number of cubes in the instancing benchmark scene, 0 runs the regular scene
+	unsigned int benchInstances = 0;
+	// draw the benchmark scene with one draw call per cube instead of instancing, for comparison
+	bool benchNoInstancing = false;
+	// time uniform uploads through each lookup path and exit
+	bool benchUniforms = false;
+	// reuse linked programs from the on-disk binary cache, off forces a cold compile
+	bool shaderCache = true;
+	// rebuild programs in the background when their GLSL files change
+	bool hotReload = true;
+	// .vsmesh file to load once, reporting load time and resident memory, then exit
+	std::string benchMesh;
+	// triangles in a synthetic OBJ that is imported single and multithreaded, 0 disables the benchmark
+	unsigned int benchImport = 0;
+	// triangles in a grid drawn with float and packed vertex layouts, 0 disables the benchmark
+	unsigned int benchLayout = 0;
+	// boxes tested against one frustum with every compiled culling path, 0 disables the benchmark
+	unsigned int benchCull = 0;
+	// skip objects outside the view frustum, off draws everything for comparison
+	bool culling = true;
+	// cull through the scene BVH instead of testing the flat bounds list
+	bool cullWithBvh = false;
+	// reject objects hidden behind the nearest cubes with the software depth buffer
+	bool occlusion = false;
+	// time the software occlusion culler on a generated scene and exit
+	bool benchOcclusion = false;
+	// boxes indexed by a BVH for the build, refit and query benchmark, 0 disables it
+	unsigned int benchBvh = 0;
+	// OBJ drawn by the scene, converted to a .vsmesh with its LOD chain next to it
+	std::string sceneMesh = "cube.obj";
+	// pick a level of detail per object from its projected error, off always draws full detail
+	bool lod = true;
+	// largest screen-space error in pixels a level of detail may show
+	float lodPixelError = 1.f;
+	// triangles in a grid simplified into a LOD chain, which is then selected for a generated scene, 0 disables it
+	unsigned int benchLod = 0;
+	// entities iterated by the ECS and by a pointer-per-object baseline, 0 disables the benchmark
+	unsigned int benchEcs = 0;
+	// objects get no spin, so the transform hierarchy has nothing to update after the first frame
+	bool staticObjects = false;
+	// draw with a reverse-Z infinite projection, which keeps depth precision at large view distances
+	bool reverseZ = false;
+	// mouse motion without the OS pointer acceleration, where the platform supports it
+	bool rawMouse = true;
+	// simulation steps per second, independent of the frame rate
+	float simulationRate = 60.f;
+	// draw into an offscreen target without showing a window, and exit after headlessFrames frames
+	bool headless = false;
+	unsigned int headlessFrames = 300;
+	// context for headless runs: "native" uses the platform's usual one, "egl" or "osmesa" need no display
+	std::string contextApi = "native";
+	// PPM file the last headless frame is written to, empty skips it
+	std::string dumpFrame;
+	// Chrome trace file the CPU and GPU zones of the first traceFrames frames are written to, empty records
+	// nothing; needs a build with ENABLE_PROFILER
+	std::string traceFile;
+	unsigned int traceFrames = 300;
+	// named scene flown through along a scripted camera path, with frame times written to benchmarkOutput;
+	// empty runs interactively
+	std::string benchmarkScene;
+	// frames measured after the warm-up, 0 measures the whole camera path
+	unsigned int benchmarkFrames = 0;
+	unsigned int benchmarkWarmup = 120;
+	std::string benchmarkOutput = "benchmark.json";
+	// nodes in a random forest whose world matrices are propagated, 0 disables the benchmark
+	unsigned int benchHierarchy = 0;
+	// objects culled and transformed on job pools of 1 thread up to every core, 0 disables the benchmark
+	unsigned int benchJobs = 0;
+};
+
 class MainEngine {
 public:
+	explicit MainEngine(const EngineConfig& config = EngineConfig()) : config(config) {}
 	int launch();
 
 private:
+	EngineConfig config;
 	FObj* obj;
+	FixedTimestep timestep;
+	unsigned int drawCalls = 0;
+	unsigned int stateChanges = 0;
+	unsigned int redundantStateChanges = 0;
+	unsigned int visibleObjects = 0;
+	unsigned int occludedObjects = 0;
+	size_t submittedTriangles = 0;
+	size_t fullDetailTriangles = 0;
+	size_t updatedTransforms = 0;
+	double transformMilliseconds = 0;
+	unsigned int simulationSteps = 0;
+	double droppedSimulationSeconds = 0;
+	unsigned int streamStalls = 0;
 	FObj* start();
-	void update();
+	void simulate(float step);
+	void update(float alpha);
 	void clearObj();
+	void finishShaders(ShaderLibrary& shaders) const;
 
 	static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
-	static void mouseCallBack(GLFWwindow* windows, double xpos, double ypos);
-	void processInput(GLFWwindow* window, double deltaTime) const;
+	void processInput(GLFWwindow* window, InputSystem& input, double deltaTime) const;
 };
 #endif
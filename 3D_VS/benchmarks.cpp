@@ -0,0 +1,520 @@
+#include "benchmarks.h"
+#include "MainEngine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include "bvh.h"
+#include "camera.h"
+#include "ecs.h"
+#include "frustum_culling.h"
+#include "job_system.h"
+#include "lod_selection.h"
+#include "mapped_file.h"
+#include "mesh.h"
+#include "mesh_converter.h"
+#include "mesh_simplifier.h"
+#include "obj_importer.h"
+#include "occlusion_culling.h"
+#include "scene_components.h"
+#include "shader_handler.h"
+#include "transform_hierarchy.h"
+#include "vertex_layout.h"
+
+// compares the cost of one mat4 upload through the old name lookup, the reflected table and a typed handle
+void benchmarkUniforms() {
+	// scene shaders take their matrices from uniform blocks, so this one keeps a plain mat4 uniform
+	ShaderSource source;
+	source.vertex = "#version 450 core\nuniform mat4 transform;\nvoid main() { gl_Position = transform * vec4(0.0, 0.0, 0.0, 1.0); }\n";
+	source.fragment = "#version 450 core\nout vec4 FragColor;\nvoid main() { FragColor = vec4(1.0); }\n";
+	Shader shader(source);
+	shader.use();
+	const auto handle = shader.uniform<glm::mat4>("transform");
+	const int calls = 1000000;
+	glm::mat4 value(1.f);
+
+	auto measure = [&](const char* label, auto&& upload) {
+		glFinish();
+		const auto begin = std::chrono::steady_clock::now();
+		for (int i = 0; i < calls; i++) {
+			value[3][0] = (float)i;
+			upload();
+		}
+		glFinish();
+		const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / calls;
+		std::cout << label << ": " << ns << " ns/call" << std::endl;
+	};
+
+	measure("glGetUniformLocation per call", [&] {
+		const std::string name = "transform";
+		glUniformMatrix4fv(glGetUniformLocation(shader.ID, name.c_str()), 1, GL_FALSE, &value[0][0]);
+	});
+	measure("reflected table lookup       ", [&] { shader.setMat4("transform", value); });
+	measure("typed handle                 ", [&] { shader.set(handle, value); });
+}
+
+// load time and resident memory of one .vsmesh, before and after the mapping is released
+void benchmarkMeshLoad(const std::string& path) {
+	const double mb = 1.0 / (1024.0 * 1024.0);
+	const size_t residentBefore = residentMemoryBytes();
+	Mesh mesh;
+	if (!mesh.load(path)) return;
+	glFinish();
+	const size_t residentAfter = residentMemoryBytes();
+	const auto& stats = mesh.loadStats();
+	std::cout << path << ": " << mesh.vertexCount << " vertices, " << mesh.indexCount / 3 << " triangles" << std::endl;
+	std::cout << "load " << stats.milliseconds << " ms, " << stats.fileBytes * mb << " MB file, " << stats.gpuBytes * mb << " MB uploaded, "
+		<< stats.fileBytes * mb / (stats.milliseconds / 1000.0) << " MB/s" << std::endl;
+	std::cout << "resident memory " << residentBefore * mb << " MB -> " << residentAfter * mb << " MB" << std::endl;
+}
+
+// imports a generated grid OBJ (positions, normals and v//vn faces) on one thread and on every hardware thread
+void benchmarkImport(unsigned int triangles) {
+	const char* path = "bench_import.obj";
+	const unsigned int side = (unsigned int)std::sqrt(triangles / 2.0) + 1;
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		std::cout << "ERROR::BENCHMARK::FAILED_TO_WRITE: " << path << std::endl;
+		return;
+	}
+	for (unsigned int y = 0; y < side; y++) {
+		for (unsigned int x = 0; x < side; x++) {
+			const float height = 0.25f * std::sin(x * 0.1f) * std::cos(y * 0.1f);
+			fprintf(file, "v %.6f %.6f %.6f\nvn %.4f %.4f %.4f\n", x * 0.01f, height, y * 0.01f, -height, 1.f, height);
+		}
+	}
+	for (unsigned int y = 0; y + 1 < side; y++) {
+		for (unsigned int x = 0; x + 1 < side; x++) {
+			const unsigned int a = y * side + x + 1, b = a + 1, c = a + side, d = c + 1;
+			fprintf(file, "f %u//%u %u//%u %u//%u %u//%u\n", a, a, b, b, d, d, c, c);
+		}
+	}
+	fclose(file);
+
+	const unsigned int threadCounts[2] = { 1, std::max(1u, std::thread::hardware_concurrency()) };
+	for (unsigned int threads : threadCounts) {
+		ObjImporter importer(threads);
+		MeshData mesh;
+		if (!importer.import(path, mesh)) break;
+		const auto& stats = importer.statistics();
+		const double seconds = stats.milliseconds / 1000.0;
+		std::cout << stats.threads << " threads: " << stats.milliseconds << " ms, " << stats.fileBytes / (1024.0 * 1024.0) / seconds << " MB/s, "
+			<< stats.triangles / seconds / 1e6 << " M triangles/s (" << stats.triangles << " triangles, " << stats.vertices << " vertices)" << std::endl;
+	}
+	remove(path);
+}
+
+// height field grid with colors and normals, for benchmarks that need a large mesh without an asset
+static MeshData makeGridMesh(unsigned int triangles) {
+	const unsigned int side = (unsigned int)std::sqrt(triangles / 2.0) + 1;
+	MeshData mesh;
+	mesh.hasNormals = true;
+	mesh.vertices.reserve((size_t)side * side);
+	for (unsigned int y = 0; y < side; y++) {
+		for (unsigned int x = 0; x < side; x++) {
+			const float u = x / (float)(side - 1), v = y / (float)(side - 1);
+			const float height = 0.1f * std::sin(u * 20.f) * std::cos(v * 20.f);
+			const float slopeU = 2.f * std::cos(u * 20.f) * std::cos(v * 20.f), slopeV = -2.f * std::sin(u * 20.f) * std::sin(v * 20.f);
+			MeshVertex vertex;
+			vertex.position = glm::vec3(u * 2.f - 1.f, height, v * 2.f - 1.f);
+			vertex.color = glm::vec3(u, 0.5f + 5.f * height, v);
+			vertex.normal = glm::normalize(glm::vec3(-slopeU / 2.f, 1.f, -slopeV / 2.f));
+			mesh.vertices.push_back(vertex);
+		}
+	}
+	mesh.indices.reserve((size_t)(side - 1) * (side - 1) * 6);
+	for (unsigned int y = 0; y + 1 < side; y++) {
+		for (unsigned int x = 0; x + 1 < side; x++) {
+			const uint32_t a = y * side + x, b = a + 1, c = a + side, d = c + 1;
+			const uint32_t quad[6] = { a, b, d, a, d, c };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+	return mesh;
+}
+
+// draws one grid stored with each vertex layout and compares vertex bytes and GPU time; the grid is scaled
+// down to a few pixels so the draws are bound by vertex fetch rather than rasterization
+void benchmarkVertexLayouts(unsigned int triangles) {
+	const MeshData grid = makeGridMesh(triangles);
+	ShaderSource source;
+	source.vertex = "#version 450 core\n"
+		"layout (location = 0) in vec3 aPos;\nlayout (location = 1) in vec3 aColor;\nlayout (location = 2) in vec3 aNormal;\n"
+		"uniform mat4 transform;\nout vec3 color;\n"
+		"void main() { color = aColor * (0.5 + 0.5 * aNormal.y); gl_Position = transform * vec4(aPos, 1.0); }\n";
+	source.fragment = "#version 450 core\nin vec3 color;\nout vec4 FragColor;\nvoid main() { FragColor = vec4(color, 1.0); }\n";
+	Shader shader(source);
+	shader.use();
+	shader.set(shader.uniform<glm::mat4>("transform"), glm::scale(glm::mat4(1.f), glm::vec3(0.01f)));
+
+	struct Candidate {
+		const char* name;
+		VertexLayout layout;
+	};
+	VertexLayout separate;
+	separate.add(VERTEX_POSITION, VertexFormat::Half4, 0).add(VERTEX_COLOR, VertexFormat::UNorm8x4, 1).add(VERTEX_NORMAL, VertexFormat::SNorm10x3, 2);
+	const Candidate candidates[] = { { "float interleaved", VertexLayout::floats() }, { "packed interleaved", VertexLayout::packed() }, { "packed separate", separate } };
+
+	const char* path = "bench_layout.vsmesh";
+	const int draws = 20;
+	GLuint query;
+	glGenQueries(1, &query);
+	double baselineBytes = 0, baselineMs = 0;
+	for (const auto& candidate : candidates) {
+		Mesh mesh;
+		if (!writeMeshFile(path, grid, candidate.layout) || !mesh.load(path)) break;
+		mesh.draw();
+		glFinish();
+
+		glBeginQuery(GL_TIME_ELAPSED, query);
+		for (int i = 0; i < draws; i++) mesh.draw();
+		glEndQuery(GL_TIME_ELAPSED);
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+
+		const double bytes = (double)mesh.loadStats().vertexBytes;
+		const double ms = nanoseconds / 1e6 / draws;
+		if (baselineBytes == 0) {
+			baselineBytes = bytes;
+			baselineMs = ms;
+		}
+		std::cout << candidate.name << ": " << bytes / mesh.vertexCount << " bytes/vertex, " << bytes / (1024.0 * 1024.0) << " MB, "
+			<< ms << " ms/draw (" << 100.0 * (1.0 - bytes / baselineBytes) << "% fewer bytes, " << 100.0 * (1.0 - ms / baselineMs) << "% faster)" << std::endl;
+	}
+	glDeleteQueries(1, &query);
+	remove(path);
+}
+
+// small boxes scattered through a 1000 unit cube, and a camera frustum at its center looking down -z
+static float benchmarkRandom(uint32_t& seed) {
+	seed = seed * 1664525u + 1013904223u;
+	return (seed >> 8) / 16777216.f;
+}
+
+static void benchmarkScene(unsigned int objects, CullBounds& bounds, Frustum& frustum) {
+	bounds.resize(objects);
+	uint32_t seed = 12345;
+	for (unsigned int i = 0; i < objects; i++) {
+		const glm::vec3 center = glm::vec3(benchmarkRandom(seed), benchmarkRandom(seed), benchmarkRandom(seed)) * 1000.f - 500.f;
+		bounds.set(i, center, glm::vec3(benchmarkRandom(seed), benchmarkRandom(seed), benchmarkRandom(seed)) * 1.5f + 0.5f);
+	}
+	const glm::mat4 view = glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+	frustum = Frustum::fromMatrix(glm::perspective(glm::radians(45.f), (float)SRC_WIDTH / (float)SRC_HEIGHT, 0.1f, 1000.f) * view);
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// random boxes around a camera at the origin, culled with every compiled path; all paths must agree
+void benchmarkCulling(unsigned int objects) {
+	CullBounds bounds;
+	Frustum frustum;
+	benchmarkScene(objects, bounds, frustum);
+
+	std::vector<uint32_t> visible;
+	const CullPath paths[] = { CullPath::Scalar, CullPath::SSE, CullPath::AVX2 };
+	for (CullPath path : paths) {
+		if ((int)path > (int)bestCullPath()) break;
+		double best = 1e30;
+		for (int run = 0; run < 20; run++) {
+			const auto begin = std::chrono::steady_clock::now();
+			cullFrustum(frustum, bounds, visible, path);
+			best = std::min(best, millisecondsSince(begin));
+		}
+		std::cout << cullPathName(path) << ": " << best << " ms, " << objects / best << " objects/ms, " << visible.size() << " of " << objects << " visible" << std::endl;
+	}
+}
+
+// BVH build on one and on every thread, full and incremental refit, and frustum query against the flat cull
+void benchmarkBvh(unsigned int objects) {
+	CullBounds bounds;
+	Frustum frustum;
+	benchmarkScene(objects, bounds, frustum);
+	std::cout << objects << " objects:" << std::endl;
+
+	Bvh bvh;
+	for (unsigned int threads : { 1u, std::max(1u, std::thread::hardware_concurrency()) }) {
+		const auto begin = std::chrono::steady_clock::now();
+		bvh.build(bounds, threads);
+		std::cout << "  build on " << threads << " threads: " << millisecondsSince(begin) << " ms, " << bvh.size() << " nodes, SAH cost " << bvh.cost() << std::endl;
+	}
+
+	// every object drifts a little, then 1% of them move again
+	uint32_t seed = 777;
+	for (unsigned int i = 0; i < objects; i++) bounds.centerX[i] += benchmarkRandom(seed) - 0.5f;
+	auto begin = std::chrono::steady_clock::now();
+	bvh.refit(bounds);
+	std::cout << "  full refit: " << millisecondsSince(begin) << " ms" << std::endl;
+	std::vector<uint32_t> moved;
+	for (unsigned int i = 0; i < objects; i += 100) {
+		bounds.centerY[i] += benchmarkRandom(seed) - 0.5f;
+		moved.push_back(i);
+	}
+	begin = std::chrono::steady_clock::now();
+	bvh.refit(bounds, moved);
+	std::cout << "  incremental refit of " << moved.size() << " objects: " << millisecondsSince(begin) << " ms, SAH cost " << bvh.cost() << std::endl;
+
+	std::vector<uint32_t> visible;
+	double best = 1e30;
+	for (int run = 0; run < 10; run++) {
+		begin = std::chrono::steady_clock::now();
+		bvh.query(frustum, bounds, visible);
+		best = std::min(best, millisecondsSince(begin));
+	}
+	const size_t bvhVisible = visible.size();
+	double flat = 1e30;
+	for (int run = 0; run < 10; run++) {
+		begin = std::chrono::steady_clock::now();
+		cullFrustum(frustum, bounds, visible);
+		flat = std::min(flat, millisecondsSince(begin));
+	}
+	std::cout << "  query: " << best << " ms, " << bvhVisible << " visible (flat " << cullPathName(bestCullPath()) << " cull: " << flat << " ms, " << visible.size() << " visible)" << std::endl;
+}
+
+// a wall of large boxes in front of a field of small ones; frustum culling first, then the occlusion pass
+void benchmarkOcclusion() {
+	CullBounds bounds;
+	Frustum frustum;
+	benchmarkScene(100000, bounds, frustum);
+	const glm::mat4 viewProjection = glm::perspective(glm::radians(45.f), (float)SRC_WIDTH / (float)SRC_HEIGHT, 0.1f, 1000.f)
+		* glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+
+	std::vector<uint32_t> visible;
+	cullFrustum(frustum, bounds, visible);
+	const size_t frustumVisible = visible.size();
+
+	JobSystem jobs;
+	OcclusionBuffer occlusion;
+	double best = 1e30, raster = 0, pyramid = 0;
+	size_t occluded = 0;
+	std::vector<uint32_t> tested;
+	for (int run = 0; run < 20; run++) {
+		const auto begin = std::chrono::steady_clock::now();
+		occlusion.begin(viewProjection);
+		for (int y = -2; y < 2; y++) {
+			for (int x = -2; x < 2; x++) {
+				occlusion.addBoxOccluder(glm::translate(glm::mat4(1.f), glm::vec3(x * 8.f + 4.f, y * 8.f + 4.f, -40.f)), glm::vec3(-3.5f), glm::vec3(3.5f));
+			}
+		}
+		occlusion.rasterize(&jobs);
+		tested = visible;
+		occluded = occlusion.filter(bounds, tested);
+		const double ms = millisecondsSince(begin);
+		if (ms < best) {
+			best = ms;
+			raster = occlusion.statistics().rasterMilliseconds;
+			pyramid = occlusion.statistics().pyramidMilliseconds;
+		}
+	}
+	std::cout << occlusion.statistics().triangles << " occluder triangles at " << occlusion.bufferWidth() << "x" << occlusion.bufferHeight() << ": raster " << raster
+		<< " ms, pyramid " << pyramid << " ms, " << best << " ms in total; " << occluded << " of " << frustumVisible << " frustum-visible boxes occluded" << std::endl;
+}
+
+// simplifies a grid into its LOD chain, then selects levels for objects scattered up to 200 units from the
+// camera and compares the triangles submitted with and without LOD
+void benchmarkLod(unsigned int triangles) {
+	MeshData grid = makeGridMesh(triangles);
+	const MeshLodStats stats = generateLods(grid);
+	std::cout << grid.lods[0].indexCount / 3 << " triangles simplified into " << stats.levels << " levels in " << stats.milliseconds << " ms" << std::endl;
+	for (size_t i = 1; i < grid.lods.size(); i++) std::cout << "  LOD " << i << ": " << grid.lods[i].indexCount / 3 << " triangles, error " << grid.lods[i].error << std::endl;
+
+	const unsigned int objects = 10000;
+	const float pixelScale = lodPixelScale(ZOOM, (float)SRC_HEIGHT);
+	std::vector<float> distances(objects);
+	std::vector<unsigned int> levels(objects, 0);
+	uint32_t seed = 4242;
+	for (auto& distance : distances) distance = 2.f + benchmarkRandom(seed) * 198.f;
+	size_t fullDetail = 0, submitted = 0;
+	std::vector<size_t> histogram(grid.lods.size(), 0);
+	for (unsigned int i = 0; i < objects; i++) {
+		levels[i] = selectLod(grid.lods.data(), (unsigned int)grid.lods.size(), distances[i], pixelScale, 1.f, levels[i]);
+		histogram[levels[i]]++;
+		fullDetail += grid.lods[0].indexCount / 3;
+		submitted += grid.lods[levels[i]].indexCount / 3;
+	}
+	std::cout << objects << " objects at 1 pixel error: " << submitted << " triangles instead of " << fullDetail << " (" << 100.0 * submitted / fullDetail << "%), objects per level:";
+	for (size_t count : histogram) std::cout << " " << count;
+	std::cout << std::endl;
+
+	// every object wobbles by 1% of its distance; hysteresis keeps most of them on their level
+	size_t switches = 0;
+	for (int frame = 0; frame < 60; frame++) {
+		for (unsigned int i = 0; i < objects; i++) {
+			const unsigned int level = selectLod(grid.lods.data(), (unsigned int)grid.lods.size(), distances[i] * (frame % 2 ? 1.01f : 0.99f), pixelScale, 1.f, levels[i]);
+			switches += level != levels[i];
+			levels[i] = level;
+		}
+	}
+	std::cout << "level switches over 60 wobbling frames: " << switches << std::endl;
+}
+
+// the spin and bounds systems run over the same objects twice: once as heap objects reached through one
+// pointer each, the way FObj used to hold its cube, with other allocations in between as in a live heap, and
+// once as ECS chunks
+void benchmarkEcs(unsigned int entities) {
+	struct HeapObject {
+		Transform transform;
+		Spin spin;
+		Bounds bounds;
+		MeshRenderer renderer;
+		Material material;
+	};
+	std::vector<HeapObject*> objects;
+	std::vector<std::unique_ptr<char[]>> clutter;
+	World world;
+	uint32_t seed = 99;
+	for (unsigned int i = 0; i < entities; i++) {
+		const Transform transform = { glm::vec3(benchmarkRandom(seed), benchmarkRandom(seed), benchmarkRandom(seed)) * 1000.f, 0.f, glm::vec3(0.f, 1.f, 0.f), 1.f };
+		const Spin spin = { 1.f, benchmarkRandom(seed) };
+		const Bounds bounds = { glm::vec3(0.5f + benchmarkRandom(seed)) };
+		objects.push_back(new HeapObject{ transform, spin, bounds, MeshRenderer{ 0, 0 }, Material{ glm::vec4(1.f) } });
+		clutter.emplace_back(new char[16 + (size_t)(benchmarkRandom(seed) * 256.f)]);
+		world.create(transform, spin, bounds, MeshRenderer{ 0, 0 }, Material{ glm::vec4(1.f) });
+	}
+
+	auto measure = [](auto&& pass) {
+		double best = 1e30;
+		for (int run = 0; run < 10; run++) {
+			const auto begin = std::chrono::steady_clock::now();
+			pass((float)run);
+			best = std::min(best, millisecondsSince(begin));
+		}
+		return best;
+	};
+	const double heapSpin = measure([&](float time) {
+		for (HeapObject* object : objects) object->transform.angle = time * object->spin.speed + object->spin.phase;
+	});
+	const double ecsSpin = measure([&](float time) {
+		world.each<Transform, Spin>([time](Transform& transform, const Spin& spin) { transform.angle = time * spin.speed + spin.phase; });
+	});
+	CullBounds cullBounds;
+	cullBounds.resize(entities);
+	const double heapGather = measure([&](float) {
+		for (size_t i = 0; i < objects.size(); i++) cullBounds.set(i, objects[i]->transform.position, objects[i]->bounds.extent * objects[i]->transform.scale);
+	});
+	const double ecsGather = measure([&](float) {
+		size_t next = 0;
+		world.eachChunk<Transform, Bounds>([&](uint32_t count, const Entity*, Transform* transforms, Bounds* boxes) {
+			for (uint32_t row = 0; row < count; row++, next++) cullBounds.set(next, transforms[row].position, boxes[row].extent * transforms[row].scale);
+		});
+	});
+
+	const double ns = 1e6 / entities;
+	std::cout << entities << " entities:" << std::endl;
+	std::cout << "  spin: pointer per object " << heapSpin << " ms (" << heapSpin * ns << " ns/entity), ECS " << ecsSpin << " ms (" << ecsSpin * ns
+		<< " ns/entity), " << heapSpin / ecsSpin << "x" << std::endl;
+	std::cout << "  bounds gather: pointer per object " << heapGather << " ms (" << heapGather * ns << " ns/entity), ECS " << ecsGather << " ms (" << ecsGather * ns
+		<< " ns/entity), " << heapGather / ecsGather << "x" << std::endl;
+	for (HeapObject* object : objects) delete object;
+}
+
+// world matrix propagation over a random forest: every node dirty on one and on every thread, 1% of the nodes
+// dirty, and a frame where nothing moved
+void benchmarkHierarchy(unsigned int nodes) {
+	TransformHierarchy hierarchy;
+	std::vector<Transform> locals;
+	uint32_t seed = 5;
+	for (unsigned int i = 0; i < nodes; i++) {
+		// about one node in ten is a root, the rest hang below a random earlier node
+		const uint32_t parent = i == 0 || benchmarkRandom(seed) < 0.1f ? TransformHierarchy::NONE : (uint32_t)(benchmarkRandom(seed) * i) % i;
+		locals.push_back(Transform{ glm::vec3(benchmarkRandom(seed), benchmarkRandom(seed), benchmarkRandom(seed)) * 10.f, benchmarkRandom(seed), glm::vec3(0.f, 1.f, 0.f), 1.f });
+		hierarchy.add(localMatrix(locals.back()), parent);
+	}
+	hierarchy.update();
+	JobSystem jobs;
+
+	auto measure = [&](const char* label, JobSystem* updateJobs, size_t dirtyCount) {
+		double best = 1e30;
+		size_t updated = 0;
+		for (int run = 0; run < 5; run++) {
+			for (size_t k = 0; k < dirtyCount; k++) {
+				const uint32_t node = dirtyCount == nodes ? (uint32_t)k : (uint32_t)(benchmarkRandom(seed) * nodes) % nodes;
+				locals[node].angle += 0.01f;
+				hierarchy.setLocal(node, localMatrix(locals[node]));
+			}
+			hierarchy.update(updateJobs);
+			best = std::min(best, hierarchy.statistics().milliseconds);
+			updated = hierarchy.statistics().updated;
+		}
+		std::cout << "  " << label << ": " << updated << " updated in " << best << " ms" << std::endl;
+	};
+	std::cout << nodes << " nodes:" << std::endl;
+	measure("all dirty, 1 thread", nullptr, nodes);
+	measure(("all dirty, " + std::to_string(jobs.threadCount()) + " threads").c_str(), &jobs, nodes);
+	measure("1% dirty", &jobs, nodes / 100);
+	measure("nothing dirty", &jobs, 0);
+}
+
+// the per-frame workloads on pools of 1, 2, 4, ... threads up to every core: frustum culling and a full
+// transform update over items objects, and fan-out/fan-in of tiny dependent jobs for the scheduling overhead
+void benchmarkJobs(unsigned int items) {
+	CullBounds bounds;
+	Frustum frustum;
+	benchmarkScene(items, bounds, frustum);
+	std::vector<uint32_t> visible;
+
+	TransformHierarchy hierarchy;
+	std::vector<glm::mat4> locals;
+	uint32_t seed = 17;
+	for (unsigned int i = 0; i < items; i++) {
+		const uint32_t parent = i < 1000 ? TransformHierarchy::NONE : (uint32_t)(benchmarkRandom(seed) * i) % i;
+		locals.push_back(glm::translate(glm::mat4(1.f), glm::vec3(benchmarkRandom(seed), benchmarkRandom(seed), benchmarkRandom(seed))));
+		hierarchy.add(locals.back(), parent);
+	}
+	hierarchy.update();
+
+	const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < cores; threads *= 2) threadCounts.push_back(threads);
+	threadCounts.push_back(cores);
+
+	auto measure = [](auto&& pass) {
+		double best = 1e30;
+		for (int run = 0; run < 10; run++) {
+			const auto begin = std::chrono::steady_clock::now();
+			pass();
+			best = std::min(best, millisecondsSince(begin));
+		}
+		return best;
+	};
+	double cullBase = 0, transformBase = 0, jobsBase = 0;
+	std::cout << items << " objects:" << std::endl;
+	for (unsigned int threads : threadCounts) {
+		JobSystem jobs(threads);
+		const double cull = measure([&]() { cullFrustum(frustum, bounds, visible, jobs); });
+		const double transform = measure([&]() {
+			for (unsigned int i = 0; i < items; i++) hierarchy.setLocal(i, locals[i]);
+			hierarchy.update(&jobs);
+		});
+		// 64 groups of 256 jobs, every group starting after the one before it
+		const double tiny = measure([&]() {
+			std::atomic<uint32_t> sum{ 0 };
+			std::vector<std::unique_ptr<JobCounter>> groups;
+			for (int g = 0; g < 64; g++) {
+				groups.push_back(std::make_unique<JobCounter>());
+				for (int k = 0; k < 256; k++) jobs.run([&sum]() { sum.fetch_add(1, std::memory_order_relaxed); }, *groups.back(), g > 0 ? groups[g - 1].get() : nullptr);
+			}
+			jobs.wait(*groups.back());
+		});
+		if (threads == 1) {
+			cullBase = cull;
+			transformBase = transform;
+			jobsBase = tiny;
+		}
+		const JobSystem::Stats stats = jobs.statistics();
+		std::cout << "  " << threads << " threads: cull " << cull << " ms (" << cullBase / cull << "x), transforms " << transform << " ms (" << transformBase / transform
+			<< "x), 16384 dependent jobs " << tiny << " ms (" << tiny * 1e6 / 16384 << " ns/job, " << jobsBase / tiny << "x), " << stats.steals << " of " << stats.jobs << " jobs stolen" << std::endl;
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <string>
+
+// standalone benchmarks selected by the --bench-* flags, each prints its numbers and returns; they project with
+// the engine's window size, and the ones timing GL calls need a current context
+void benchmarkUniforms();
+void benchmarkMeshLoad(const std::string& path);
+void benchmarkImport(unsigned int triangles);
+void benchmarkVertexLayouts(unsigned int triangles);
+void benchmarkCulling(unsigned int objects);
+void benchmarkBvh(unsigned int objects);
+void benchmarkOcclusion();
+void benchmarkLod(unsigned int triangles);
+void benchmarkEcs(unsigned int entities);
+void benchmarkHierarchy(unsigned int nodes);
+void benchmarkJobs(unsigned int items);
+#endif
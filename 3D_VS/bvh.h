@@ -0,0 +1,309 @@
+#pragma once
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "frustum_culling.h"
+
+// bounding volume hierarchy over a CullBounds list: binned SAH build (top levels in parallel), bottom-up refit
+// when objects move, and frustum queries that skip whole subtrees
+class Bvh {
+public:
+	// 32 bytes; interior nodes keep their children next to each other at left and left + 1
+	struct Node {
+		glm::vec3 boundsMin;
+		uint32_t first; // leaf: first entry in the object order, interior: left child
+		glm::vec3 boundsMax;
+		uint32_t count; // objects in a leaf, 0 for interior nodes
+	};
+
+	// 0 threads uses every hardware thread
+	void build(const CullBounds& bounds, unsigned int threads = 0) {
+		const uint32_t count = (uint32_t)bounds.size();
+		nodes.clear();
+		objects.clear();
+		parents.clear();
+		leafOf.clear();
+		if (count == 0) return;
+
+		// boxes are expanded once up front and partitioned in place, the final order becomes the object list
+		items.resize(count);
+		for (uint32_t i = 0; i < count; i++) items[i] = { objectMin(bounds, i), objectMax(bounds, i), centroid(bounds, i), i };
+
+		// children always get higher indices than their parent, which refit relies on
+		nodes.resize(2 * (size_t)count);
+		nodeCount = 1;
+		const unsigned int threadCount = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+		unsigned int parallelDepth = 0;
+		while ((1u << parallelDepth) < threadCount) parallelDepth++;
+		buildNode(0, 0, count, parallelDepth);
+		nodes.resize(nodeCount);
+		nodes.shrink_to_fit();
+		objects.resize(count);
+		for (uint32_t i = 0; i < count; i++) objects[i] = items[i].object;
+		items = std::vector<BuildItem>();
+
+		parents.assign(nodes.size(), 0);
+		leafOf.assign(count, 0);
+		for (uint32_t n = 0; n < nodes.size(); n++) {
+			const Node& node = nodes[n];
+			if (node.count == 0) parents[node.first] = parents[node.first + 1] = n;
+			else for (uint32_t i = node.first; i < node.first + node.count; i++) leafOf[objects[i]] = n;
+		}
+	}
+
+	// recomputes every box bottom-up after many objects moved; the tree shape is kept
+	void refit(const CullBounds& bounds) {
+		for (size_t n = nodes.size(); n-- > 0;) updateNode(bounds, (uint32_t)n);
+	}
+
+	// refits only the paths from the moved objects' leaves to the root, stopping where a box stops changing
+	void refit(const CullBounds& bounds, const std::vector<uint32_t>& moved) {
+		for (uint32_t object : moved) {
+			uint32_t n = leafOf[object];
+			for (;;) {
+				if (!updateNode(bounds, n) || n == 0) break;
+				n = parents[n];
+			}
+		}
+	}
+
+	// appends every object touching the frustum; subtrees fully inside are taken without further plane tests
+	void query(const Frustum& frustum, const CullBounds& bounds, std::vector<uint32_t>& visible) const {
+		visible.clear();
+		if (nodes.empty()) return;
+		// node index plus the planes its parent was not already fully inside of
+		uint32_t stack[128];
+		uint8_t planeStack[128];
+		int top = 0;
+		stack[top] = 0;
+		planeStack[top++] = 0x3F;
+		while (top > 0) {
+			top--;
+			const Node& node = nodes[stack[top]];
+			uint8_t planes = planeStack[top];
+			bool outside = false;
+			for (int p = 0; p < 6 && !outside; p++) {
+				if (!(planes & (1 << p))) continue;
+				const glm::vec4& plane = frustum.planes[p];
+				const glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f, extent = (node.boundsMax - node.boundsMin) * 0.5f;
+				const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+				const float radius = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+				if (distance + radius < 0.f) outside = true;
+				else if (distance - radius >= 0.f) planes &= ~(1 << p);
+			}
+			if (outside) continue;
+			if (planes == 0) {
+				appendSubtree(stack[top], visible);
+				continue;
+			}
+			if (node.count > 0) {
+				for (uint32_t i = node.first; i < node.first + node.count; i++) {
+					if (boxInFrustum(frustum, bounds, objects[i])) visible.push_back(objects[i]);
+				}
+				continue;
+			}
+			if (top + 2 > 128) {
+				// deeper than any SAH tree over 32-bit indices gets in practice, fall back to taking the subtree
+				appendSubtree(stack[top], visible);
+				continue;
+			}
+			stack[top] = node.first;
+			planeStack[top++] = planes;
+			stack[top] = node.first + 1;
+			planeStack[top++] = planes;
+		}
+	}
+
+	size_t size() const {
+		return nodes.size();
+	}
+
+	// surface area heuristic cost of the tree, grows as refits loosen it; rebuild when it drifts too far
+	float cost() const {
+		if (nodes.empty()) return 0.f;
+		const float rootArea = area(nodes[0].boundsMin, nodes[0].boundsMax);
+		if (rootArea <= 0.f) return 0.f;
+		float total = 0.f;
+		for (const Node& node : nodes) total += area(node.boundsMin, node.boundsMax) * (node.count ? (float)node.count : TRAVERSAL_COST);
+		return total / rootArea;
+	}
+
+private:
+	static const int BIN_COUNT = 16;
+	static const uint32_t MIN_SPLIT_SIZE = 4; // smaller nodes always become leaves, culling tests their objects directly
+	static const uint32_t MAX_LEAF_SIZE = 8;
+	static const uint32_t PARALLEL_THRESHOLD = 16384;
+	static constexpr float TRAVERSAL_COST = 1.f;
+
+	struct BuildItem {
+		glm::vec3 boundsMin, boundsMax, centroid;
+		uint32_t object;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<BuildItem> items; // only alive during build()
+	std::atomic<uint32_t> nodeCount{ 0 };
+	std::vector<uint32_t> objects; // object indices, every leaf covers a contiguous range
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> leafOf;
+
+	static float area(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+		const glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0.f));
+		return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	static glm::vec3 objectMin(const CullBounds& bounds, uint32_t i) {
+		return glm::vec3(bounds.centerX[i] - bounds.extentX[i], bounds.centerY[i] - bounds.extentY[i], bounds.centerZ[i] - bounds.extentZ[i]);
+	}
+
+	static glm::vec3 objectMax(const CullBounds& bounds, uint32_t i) {
+		return glm::vec3(bounds.centerX[i] + bounds.extentX[i], bounds.centerY[i] + bounds.extentY[i], bounds.centerZ[i] + bounds.extentZ[i]);
+	}
+
+	static glm::vec3 centroid(const CullBounds& bounds, uint32_t i) {
+		return glm::vec3(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+	}
+
+	void buildNode(uint32_t index, uint32_t first, uint32_t count, unsigned int parallelDepth) {
+		Node& node = nodes[index];
+		glm::vec3 boundsMin(1e30f), boundsMax(-1e30f), centroidMin(1e30f), centroidMax(-1e30f);
+		for (uint32_t i = first; i < first + count; i++) {
+			boundsMin = glm::min(boundsMin, items[i].boundsMin);
+			boundsMax = glm::max(boundsMax, items[i].boundsMax);
+			centroidMin = glm::min(centroidMin, items[i].centroid);
+			centroidMax = glm::max(centroidMax, items[i].centroid);
+		}
+		node.boundsMin = boundsMin;
+		node.boundsMax = boundsMax;
+		node.first = first;
+		node.count = count;
+		if (count <= MIN_SPLIT_SIZE) return;
+
+		// one pass bins every object on all three axes, then the cheapest bin boundary wins
+		glm::vec3 binMin[3][BIN_COUNT], binMax[3][BIN_COUNT];
+		uint32_t binCount[3][BIN_COUNT] = {};
+		for (int axis = 0; axis < 3; axis++) {
+			for (int b = 0; b < BIN_COUNT; b++) {
+				binMin[axis][b] = glm::vec3(1e30f);
+				binMax[axis][b] = glm::vec3(-1e30f);
+			}
+		}
+		const glm::vec3 centroidExtent = centroidMax - centroidMin;
+		glm::vec3 scale;
+		for (int axis = 0; axis < 3; axis++) scale[axis] = centroidExtent[axis] > 0.f ? BIN_COUNT / centroidExtent[axis] : 0.f;
+		for (uint32_t i = first; i < first + count; i++) {
+			const BuildItem& item = items[i];
+			for (int axis = 0; axis < 3; axis++) {
+				const int b = std::min(BIN_COUNT - 1, (int)((item.centroid[axis] - centroidMin[axis]) * scale[axis]));
+				binCount[axis][b]++;
+				binMin[axis][b] = glm::min(binMin[axis][b], item.boundsMin);
+				binMax[axis][b] = glm::max(binMax[axis][b], item.boundsMax);
+			}
+		}
+
+		int bestAxis = -1, bestSplit = 0;
+		float bestCost = 1e30f;
+		for (int axis = 0; axis < 3; axis++) {
+			if (centroidExtent[axis] <= 0.f) continue;
+			// right-to-left sweep first, then evaluate every boundary from the left
+			float rightArea[BIN_COUNT];
+			uint32_t rightCount[BIN_COUNT];
+			glm::vec3 sweepMin(1e30f), sweepMax(-1e30f);
+			uint32_t sweepCount = 0;
+			for (int b = BIN_COUNT - 1; b > 0; b--) {
+				sweepMin = glm::min(sweepMin, binMin[axis][b]);
+				sweepMax = glm::max(sweepMax, binMax[axis][b]);
+				sweepCount += binCount[axis][b];
+				rightArea[b] = area(sweepMin, sweepMax);
+				rightCount[b] = sweepCount;
+			}
+			sweepMin = glm::vec3(1e30f);
+			sweepMax = glm::vec3(-1e30f);
+			sweepCount = 0;
+			for (int b = 0; b < BIN_COUNT - 1; b++) {
+				sweepMin = glm::min(sweepMin, binMin[axis][b]);
+				sweepMax = glm::max(sweepMax, binMax[axis][b]);
+				sweepCount += binCount[axis][b];
+				if (sweepCount == 0 || rightCount[b + 1] == 0) continue;
+				const float cost = sweepCount * area(sweepMin, sweepMax) + rightCount[b + 1] * rightArea[b + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b + 1;
+				}
+			}
+		}
+
+		const float leafCost = count * area(boundsMin, boundsMax);
+		uint32_t middle = first;
+		if (bestAxis >= 0 && (TRAVERSAL_COST * area(boundsMin, boundsMax) + bestCost < leafCost || count > MAX_LEAF_SIZE)) {
+			const float axisScale = scale[bestAxis], axisMin = centroidMin[bestAxis];
+			middle = (uint32_t)(std::partition(items.begin() + first, items.begin() + first + count, [&](const BuildItem& item) {
+				return std::min(BIN_COUNT - 1, (int)((item.centroid[bestAxis] - axisMin) * axisScale)) < bestSplit;
+			}) - items.begin());
+		}
+		else if (count > MAX_LEAF_SIZE) {
+			// every centroid in the same spot, split the list in half
+			middle = first + count / 2;
+		}
+		else return;
+
+		const uint32_t left = nodeCount.fetch_add(2);
+		node.first = left;
+		node.count = 0;
+		const uint32_t leftCount = middle - first;
+		if (parallelDepth > 0 && count > PARALLEL_THRESHOLD) {
+			std::thread worker([=]() { buildNode(left, first, leftCount, parallelDepth - 1); });
+			buildNode(left + 1, middle, count - leftCount, parallelDepth - 1);
+			worker.join();
+		}
+		else {
+			buildNode(left, first, leftCount, 0);
+			buildNode(left + 1, middle, count - leftCount, 0);
+		}
+	}
+
+	// returns whether the node's box changed
+	bool updateNode(const CullBounds& bounds, uint32_t index) {
+		Node& node = nodes[index];
+		glm::vec3 boundsMin(1e30f), boundsMax(-1e30f);
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				boundsMin = glm::min(boundsMin, objectMin(bounds, objects[i]));
+				boundsMax = glm::max(boundsMax, objectMax(bounds, objects[i]));
+			}
+		}
+		else {
+			boundsMin = glm::min(nodes[node.first].boundsMin, nodes[node.first + 1].boundsMin);
+			boundsMax = glm::max(nodes[node.first].boundsMax, nodes[node.first + 1].boundsMax);
+		}
+		const bool changed = !(boundsMin == node.boundsMin) || !(boundsMax == node.boundsMax);
+		node.boundsMin = boundsMin;
+		node.boundsMax = boundsMax;
+		return changed;
+	}
+
+	void appendSubtree(uint32_t index, std::vector<uint32_t>& visible) const {
+		std::vector<uint32_t> pending(1, index);
+		while (!pending.empty()) {
+			const Node& node = nodes[pending.back()];
+			pending.pop_back();
+			if (node.count > 0) visible.insert(visible.end(), objects.begin() + node.first, objects.begin() + node.first + node.count);
+			else {
+				pending.push_back(node.first);
+				pending.push_back(node.first + 1);
+			}
+		}
+	}
+};
+
+#endif
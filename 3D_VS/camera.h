@@ -5,6 +5,11 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cmath>
+
+#include "frustum_culling.h"
 
 
 enum Camera_Movement {
@@ -19,70 +24,135 @@ const float PITCH = 0.f;
 const float SPEED = 2.5f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.f;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.f;
 
+// fly camera whose orientation is a quaternion. Input only accumulates yaw and pitch; the orientation, view,
+// projection, view-projection and frustum planes are rebuilt on first use after something changed, so any number
+// of mouse events per frame cost one rebuild and a camera that did not move costs none
 class Camera {
 public:
-    // camera Attributes
-    glm::vec3 Position;
-    glm::vec3 Front;
-    glm::vec3 Up;
-    glm::vec3 Right;
-    glm::vec3 WorldUp;
-    // euler Angles
-    float Yaw;
-    float Pitch;
     // camera options
     float MovementSpeed;
     float MouseSensitivity;
-    float Zoom;
 
     // constructor with vectors
-    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM) {
-        Position = position;
-        WorldUp = up;
-        Yaw = yaw;
-        Pitch = pitch;
-        updateCameraVectors();
-    }
+    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Position(position), WorldUp(up), Yaw(yaw), Pitch(pitch) {}
     // constructor with scalar values
-    Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM) {
-        Position = glm::vec3(posX, posY, posZ);
-        WorldUp = glm::vec3(upX, upY, upZ);
-        Yaw = yaw;
-        Pitch = pitch;
-        updateCameraVectors();
+    Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Camera(glm::vec3(posX, posY, posZ), glm::vec3(upX, upY, upZ), yaw, pitch) {}
+
+    glm::vec3 GetPosition() const {
+        return Position;
+    }
+
+    float GetZoom() const {
+        return Zoom;
+    }
+
+    const glm::quat& GetOrientation() const {
+        updateOrientation();
+        return Orientation;
+    }
+
+    glm::vec3 GetFront() const {
+        updateOrientation();
+        return Front;
+    }
+
+    glm::vec3 GetRight() const {
+        updateOrientation();
+        return Right;
+    }
+
+    glm::vec3 GetUp() const {
+        updateOrientation();
+        return Up;
+    }
+
+    // returns the view matrix, the inverse of the camera's rotation and translation
+    const glm::mat4& GetViewMatrix() const {
+        updateMatrices();
+        return View;
+    }
+
+    // the projection the GPU draws with: reverse-Z with an infinite far plane, or the usual one ending at the far plane
+    const glm::mat4& GetProjectionMatrix() const {
+        updateMatrices();
+        return Projection;
+    }
+
+    const glm::mat4& GetViewProjectionMatrix() const {
+        updateMatrices();
+        return ViewProjection;
     }
 
-    // returns the view matrix calculated using Euler Angles and the LookAt Matrix
-    glm::mat4 GetViewMatrix() {
-        return glm::lookAt(Position, Position + Front, Up);
+    // view-projection with the usual -1..1 depth range, for CPU code that works in clip space like the occlusion
+    // culler; the same as GetViewProjectionMatrix() unless reverse-Z is on, then its far plane is at infinity too
+    const glm::mat4& GetCullingMatrix() const {
+        updateMatrices();
+        return Culling;
+    }
+
+    const Frustum& GetFrustum() const {
+        updateMatrices();
+        return FrustumPlanes;
+    }
+
+    // width over height of the viewport drawn to
+    void SetAspect(float aspect) {
+        if (aspect == Aspect) return;
+        Aspect = aspect;
+        matricesDirty = true;
+    }
+
+    void SetClipPlanes(float nearPlane, float farPlane) {
+        NearPlane = nearPlane;
+        FarPlane = farPlane;
+        matricesDirty = true;
+    }
+
+    // reverse-Z maps the near plane to depth 1 and infinity to 0; float depth keeps its precision where the
+    // distances are large. Drawing with it needs glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE), a depth clear to
+    // 0 and GL_GREATER depth testing
+    void SetReverseZ(bool enabled) {
+        ReverseZ = enabled;
+        matricesDirty = true;
+    }
+
+    bool IsReverseZ() const {
+        return ReverseZ;
+    }
+
+    // places the camera directly, for scripted paths that bypass mouse and keyboard input
+    void SetPose(glm::vec3 position, float yaw, float pitch) {
+        Position = position;
+        Yaw = yaw;
+        Pitch = pitch;
+        orientationDirty = matricesDirty = true;
     }
 
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime) {
+        updateOrientation();
         float velocity = MovementSpeed * deltaTime;
         if (direction == FORWARD) Position += Front * velocity;
         if (direction == BACKWARD) Position -= Front * velocity;
         if (direction == LEFT) Position -= Right * velocity;
         if (direction == RIGHT) Position += Right * velocity;
+        matricesDirty = true;
     }
 
     // processes input received from a mouse input system. Expects the offset value in both the x and y direction.
     void ProcessMouseMovement(float xoffset, float yoffset, GLboolean constrainPitch = true) {
-        xoffset *= MouseSensitivity;
-        yoffset *= MouseSensitivity;
-
-        Yaw += xoffset;
-        Pitch += yoffset;
+        Yaw += xoffset * MouseSensitivity;
+        Pitch += yoffset * MouseSensitivity;
 
         // make sure that when pitch is out of bounds, screen doesn't get flipped
         if (constrainPitch) {
             if (Pitch > 89.0f) Pitch = 89.0f;
             if (Pitch < -89.0f) Pitch = -89.0f;
         }
-
-        // update Front, Right and Up Vectors using the updated Euler angles
-        updateCameraVectors();
+        orientationDirty = matricesDirty = true;
     }
 
     // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
@@ -90,20 +160,72 @@ public:
         Zoom -= (float)yoffset;
         if (Zoom < 1.0f) Zoom = 1.0f;
         if (Zoom > 45.0f) Zoom = 45.0f;
+        matricesDirty = true;
     }
 
 private:
-    // calculates the front vector from the Camera's (updated) Euler Angles
-    void updateCameraVectors() {
-        // calculate the new Front vector
-        glm::vec3 front;
-        front.x = cos(glm::radians(Yaw)) * cos(glm::radians(Pitch));
-        front.y = sin(glm::radians(Pitch));
-        front.z = sin(glm::radians(Yaw)) * cos(glm::radians(Pitch));
-        Front = glm::normalize(front);
-        // also re-calculate the Right and Up vector
-        Right = glm::normalize(glm::cross(Front, WorldUp));  // normalize the vectors, because their length gets closer to 0 the more you look up or down which results in slower movement.
-        Up = glm::normalize(glm::cross(Right, Front));
+    glm::vec3 Position;
+    glm::vec3 WorldUp;
+    // euler Angles, in degrees; a yaw of -90 looks down -z
+    float Yaw;
+    float Pitch;
+    float Zoom = ZOOM;
+    float Aspect = 1.f;
+    float NearPlane = NEAR_PLANE;
+    float FarPlane = FAR_PLANE;
+    bool ReverseZ = false;
+
+    // derived from the above on demand
+    mutable bool orientationDirty = true;
+    mutable bool matricesDirty = true;
+    mutable glm::quat Orientation = glm::quat(1.f, 0.f, 0.f, 0.f);
+    mutable glm::vec3 Front = glm::vec3(0.f, 0.f, -1.f);
+    mutable glm::vec3 Up = glm::vec3(0.f, 1.f, 0.f);
+    mutable glm::vec3 Right = glm::vec3(1.f, 0.f, 0.f);
+    mutable glm::mat4 View = glm::mat4(1.f);
+    mutable glm::mat4 Projection = glm::mat4(1.f);
+    mutable glm::mat4 ViewProjection = glm::mat4(1.f);
+    mutable glm::mat4 Culling = glm::mat4(1.f);
+    mutable Frustum FrustumPlanes;
+
+    // yaw turns about the world up axis and pitch about the camera's own x axis; the camera looks down its -z
+    void updateOrientation() const {
+        if (!orientationDirty) return;
+        orientationDirty = false;
+        const glm::quat yaw = glm::angleAxis(glm::radians(-90.f - Yaw), WorldUp);
+        const glm::quat pitch = glm::angleAxis(glm::radians(Pitch), glm::vec3(1.f, 0.f, 0.f));
+        Orientation = glm::normalize(yaw * pitch);
+        const glm::mat3 rotation = glm::mat3_cast(Orientation);
+        Right = rotation[0];
+        Up = rotation[1];
+        Front = -rotation[2];
+    }
+
+    void updateMatrices() const {
+        updateOrientation();
+        if (!matricesDirty) return;
+        matricesDirty = false;
+        // the inverse of a rotation is its transpose
+        const glm::mat3 inverse = glm::transpose(glm::mat3_cast(Orientation));
+        View = glm::mat4(inverse);
+        View[3] = glm::vec4(-(inverse * Position), 1.f);
+
+        const float fovy = glm::radians(Zoom);
+        if (ReverseZ) {
+            const float focal = 1.f / std::tan(fovy * 0.5f);
+            Projection = glm::mat4(0.f);
+            Projection[0][0] = focal / Aspect;
+            Projection[1][1] = focal;
+            Projection[2][3] = -1.f;
+            Projection[3][2] = NearPlane;
+            Culling = glm::infinitePerspective(fovy, Aspect, NearPlane) * View;
+        }
+        else {
+            Projection = glm::perspective(fovy, Aspect, NearPlane, FarPlane);
+            Culling = Projection * View;
+        }
+        ViewProjection = Projection * View;
+        FrustumPlanes = Frustum::fromMatrix(Culling);
     }
 };
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+
+// one pose the camera passes through, at a time in seconds from the start of the path
+struct CameraKey {
+	float time;
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+};
+
+// scripted camera flight through key poses, Catmull-Rom interpolated in position and angles, so benchmark
+// runs see the same frames every time; times before the first or after the last key hold that pose
+class CameraPath {
+public:
+	// keys must come in increasing time
+	void add(const CameraKey& key) {
+		keys.push_back(key);
+	}
+
+	float duration() const {
+		return keys.empty() ? 0.f : keys.back().time;
+	}
+
+	CameraKey sample(float time) const {
+		if (keys.empty()) return CameraKey{ time, glm::vec3(0.f), -90.f, 0.f };
+		if (time <= keys.front().time) return keys.front();
+		if (time >= keys.back().time) return keys.back();
+		size_t i = 1;
+		while (keys[i].time < time) i++;
+		const CameraKey& p0 = keys[i > 1 ? i - 2 : 0];
+		const CameraKey& p1 = keys[i - 1];
+		const CameraKey& p2 = keys[i];
+		const CameraKey& p3 = keys[std::min(i + 1, keys.size() - 1)];
+		const float t = (time - p1.time) / std::max(p2.time - p1.time, 1e-6f);
+		CameraKey result;
+		result.time = time;
+		result.position = catmullRom(p0.position, p1.position, p2.position, p3.position, t);
+		result.yaw = catmullRom(p0.yaw, p1.yaw, p2.yaw, p3.yaw, t);
+		result.pitch = catmullRom(p0.pitch, p1.pitch, p2.pitch, p3.pitch, t);
+		return result;
+	}
+
+private:
+	std::vector<CameraKey> keys;
+
+	template<typename T>
+	static T catmullRom(const T& p0, const T& p1, const T& p2, const T& p3, float t) {
+		const float t2 = t * t, t3 = t2 * t;
+		return 0.5f * ((2.f * p1) + (p2 - p0) * t + (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t2 + (3.f * p1 - p0 - 3.f * p2 + p3) * t3);
+	}
+};
+
+#endif
@@ -0,0 +1,133 @@
+#pragma once
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "gl_state_cache.h"
+
+// passes are submitted in this order, everything in one pass before the next
+enum class DrawPass {
+	Opaque = 0
+};
+
+// packed sort key, most significant first: pass (4 bits), program (12), material (8), vertex array (12), index
+// range within the vertex array such as the level of detail (4) and depth (24). Sorting by it groups draws by
+// their most expensive state changes; GL names are truncated to their bit counts, which only costs order on a
+// collision, never correctness, since packets keep the full names
+inline uint64_t makeDrawKey(DrawPass pass, GLuint program, uint32_t material, GLuint vertexArray, uint32_t range, float depth) {
+	// depth in [0, 1), nearer first
+	const uint64_t depthBits = (uint64_t)(std::min(std::max(depth, 0.f), 1.f) * 16777215.f);
+	return (uint64_t)pass << 60 | (uint64_t)(program & 0xFFF) << 48 | (uint64_t)(material & 0xFF) << 40
+		| (uint64_t)(vertexArray & 0xFFF) << 28 | (uint64_t)(range & 0xF) << 24 | depthBits;
+}
+
+// one draw as plain data: program, vertex array, index range and the instances it covers in this frame's
+// instance stream. Packets are recorded on any thread; only DrawSubmitter turns them into GL calls
+struct DrawPacket {
+	uint64_t key = 0;
+	GLuint program = 0;
+	GLuint vertexArray = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+	GLsizei indexCount = 0;
+	uintptr_t indexOffset = 0;
+	GLuint firstInstance = 0;
+	GLsizei instanceCount = 0;
+};
+
+// linear command buffer owned by one job for the frame; cleared, not freed, so it stops allocating once it
+// has seen the largest frame
+class DrawList {
+public:
+	std::vector<DrawPacket> packets;
+
+	void clear() {
+		packets.clear();
+	}
+
+	void add(const DrawPacket& packet) {
+		packets.push_back(packet);
+	}
+};
+
+// the per-instance vertex stream every packet of a frame reads, bound to the same binding of each vertex array
+struct InstanceStream {
+	GLuint buffer = 0;
+	GLintptr offset = 0;
+	GLsizei stride = 0;
+	GLuint binding = 0;
+};
+
+struct DrawSortEntry {
+	uint64_t key;
+	const DrawPacket* packet;
+};
+
+// LSD radix sort by key, one byte per pass; stable, and passes over a byte every key shares are skipped, so
+// the usual handful of distinct programs and vertex arrays costs only a few passes
+inline void radixSortDrawKeys(std::vector<DrawSortEntry>& entries, std::vector<DrawSortEntry>& scratch) {
+	scratch.resize(entries.size());
+	for (unsigned int shift = 0; shift < 64; shift += 8) {
+		size_t offsets[256] = {};
+		for (const auto& entry : entries) offsets[(entry.key >> shift) & 0xFF]++;
+		if (offsets[(entries.empty() ? 0 : entries[0].key >> shift) & 0xFF] == entries.size()) continue;
+		size_t sum = 0;
+		for (size_t& offset : offsets) {
+			const size_t count = offset;
+			offset = sum;
+			sum += count;
+		}
+		for (const auto& entry : entries) scratch[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+		entries.swap(scratch);
+	}
+}
+
+// merges the lists recorded for a frame and replays them on the GL thread: packets are radix sorted by key,
+// packets of the same mesh range whose instances follow each other become one draw, and state goes through
+// the cache, so nothing already bound is bound again
+class DrawSubmitter {
+public:
+	struct Stats {
+		unsigned int drawCalls = 0;
+		size_t packets = 0;
+	};
+
+	// merge off keeps one draw per packet, for comparison with per-object submission
+	Stats submit(const std::vector<DrawList>& lists, const InstanceStream& instances, GlStateCache& state, bool merge = true) {
+		order.clear();
+		for (const auto& list : lists) {
+			for (const auto& packet : list.packets) order.push_back({ packet.key, &packet });
+		}
+		// stable, so packets with equal keys keep the recording order their instances were laid out in
+		radixSortDrawKeys(order, scratch);
+
+		Stats stats;
+		stats.packets = order.size();
+		for (size_t i = 0; i < order.size();) {
+			DrawPacket draw = *order[i++].packet;
+			while (merge && i < order.size() && sameRange(draw, *order[i].packet) && order[i].packet->firstInstance == draw.firstInstance + (GLuint)draw.instanceCount) {
+				draw.instanceCount += order[i++].packet->instanceCount;
+			}
+			state.useProgram(draw.program);
+			state.bindVertexArray(draw.vertexArray);
+			state.bindVertexBuffer(instances.binding, instances.buffer, instances.offset, instances.stride);
+			glDrawElementsInstancedBaseInstance(GL_TRIANGLES, draw.indexCount, draw.indexType, (const void*)draw.indexOffset, draw.instanceCount, draw.firstInstance);
+			stats.drawCalls++;
+		}
+		return stats;
+	}
+
+private:
+	std::vector<DrawSortEntry> order;
+	std::vector<DrawSortEntry> scratch;
+
+	static bool sameRange(const DrawPacket& a, const DrawPacket& b) {
+		return a.program == b.program && a.vertexArray == b.vertexArray && a.indexOffset == b.indexOffset && a.indexCount == b.indexCount;
+	}
+};
+
+#endif
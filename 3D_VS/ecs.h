@@ -0,0 +1,245 @@
+#pragma once
+#ifndef ECS_H
+#define ECS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// archetype based entity-component storage: entities with the same set of component types share an
+// archetype, whose fixed size chunks keep one tightly packed array per component (SoA). Systems walk the
+// chunks of every matching archetype front to back, so iteration touches only the components it asks for.
+// Components must be trivially copyable, they are moved with memcpy
+
+// handle to an entity; the generation tells a recycled slot apart from the entity that used it before
+struct Entity {
+	uint32_t index = 0xFFFFFFFFu;
+	uint32_t generation = 0;
+
+	bool operator==(const Entity& other) const {
+		return index == other.index && generation == other.generation;
+	}
+
+	bool operator!=(const Entity& other) const {
+		return !(*this == other);
+	}
+};
+
+// component ids are bits of a 64-bit archetype mask
+const uint32_t ECS_MAX_COMPONENTS = 64;
+const size_t ECS_CHUNK_BYTES = 16 * 1024;
+
+inline uint32_t nextComponentId() {
+	static uint32_t next = 0;
+	return next++;
+}
+
+// small dense id per component type, handed out on first use
+template<typename T>
+uint32_t componentId() {
+	static const uint32_t id = nextComponentId();
+	return id;
+}
+
+class World {
+public:
+	World() = default;
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	template<typename... Components>
+	Entity create(const Components&... components) {
+		static_assert(sizeof...(Components) > 0, "an entity needs at least one component");
+		static_assert(std::conjunction<std::is_trivially_copyable<Components>...>::value, "components must be trivially copyable");
+		Archetype& archetype = archetypeFor<Components...>();
+		if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity) archetype.chunks.push_back(archetype.newChunk());
+		Chunk& chunk = archetype.chunks.back();
+		const uint32_t row = chunk.count++;
+
+		Entity entity;
+		if (!freeRecords.empty()) {
+			entity.index = freeRecords.back();
+			freeRecords.pop_back();
+		}
+		else {
+			entity.index = (uint32_t)records.size();
+			records.push_back(Record());
+		}
+		Record& record = records[entity.index];
+		entity.generation = record.generation;
+		record.alive = true;
+		record.archetype = (uint32_t)(&archetype - archetypes.data());
+		record.chunk = (uint32_t)(archetype.chunks.size() - 1);
+		record.row = row;
+
+		((Entity*)chunk.memory.get())[row] = entity;
+		(std::memcpy(archetype.component(chunk, componentId<Components>(), row), &components, sizeof(Components)), ...);
+		alive++;
+		return entity;
+	}
+
+	// the last entity of the archetype moves into the hole, so chunks stay densely packed
+	void destroy(Entity entity) {
+		if (!isAlive(entity)) return;
+		Record& record = records[entity.index];
+		Archetype& archetype = archetypes[record.archetype];
+		Chunk& last = archetype.chunks.back();
+		const uint32_t lastRow = last.count - 1;
+		const Entity moved = ((Entity*)last.memory.get())[lastRow];
+		if (moved != entity) {
+			Chunk& chunk = archetype.chunks[record.chunk];
+			((Entity*)chunk.memory.get())[record.row] = moved;
+			for (size_t c = 0; c < archetype.types.size(); c++) {
+				const size_t size = archetype.types[c].size;
+				std::memcpy(chunk.memory.get() + archetype.offsets[c] + record.row * size, last.memory.get() + archetype.offsets[c] + lastRow * size, size);
+			}
+			records[moved.index].chunk = record.chunk;
+			records[moved.index].row = record.row;
+		}
+		if (--last.count == 0) archetype.chunks.pop_back();
+		record.alive = false;
+		record.generation++;
+		freeRecords.push_back(entity.index);
+		alive--;
+	}
+
+	bool isAlive(Entity entity) const {
+		return entity.index < records.size() && records[entity.index].alive && records[entity.index].generation == entity.generation;
+	}
+
+	// the entity's component, nullptr when it has none or is gone; valid until the next create or destroy
+	template<typename T>
+	T* get(Entity entity) {
+		if (!isAlive(entity)) return nullptr;
+		const Record& record = records[entity.index];
+		Archetype& archetype = archetypes[record.archetype];
+		if ((archetype.mask & componentBit<T>()) == 0) return nullptr;
+		return (T*)archetype.component(archetype.chunks[record.chunk], componentId<T>(), record.row);
+	}
+
+	// calls f(count, entities, arrays...) once per chunk of every archetype holding all the requested
+	// components, with one pointer per component type to its first element in the chunk
+	template<typename... Components, typename F>
+	void eachChunk(F&& f) {
+		const uint64_t mask = (componentBit<Components>() | ...);
+		for (auto& archetype : archetypes) {
+			if ((archetype.mask & mask) != mask) continue;
+			const size_t offsets[] = { archetype.offsets[archetype.column(componentId<Components>())]... };
+			for (auto& chunk : archetype.chunks) callChunk<Components...>(f, chunk, offsets, std::index_sequence_for<Components...>());
+		}
+	}
+
+	// calls f(components...) for every entity holding all the requested components
+	template<typename... Components, typename F>
+	void each(F&& f) {
+		eachChunk<Components...>([&f](uint32_t count, const Entity*, Components*... arrays) {
+			for (uint32_t row = 0; row < count; row++) f(arrays[row]...);
+		});
+	}
+
+	// entities holding all the requested components
+	template<typename... Components>
+	size_t count() const {
+		const uint64_t mask = (componentBit<Components>() | ...);
+		size_t result = 0;
+		for (const auto& archetype : archetypes) {
+			if ((archetype.mask & mask) != mask) continue;
+			for (const auto& chunk : archetype.chunks) result += chunk.count;
+		}
+		return result;
+	}
+
+	size_t size() const {
+		return alive;
+	}
+
+private:
+	struct ComponentType {
+		uint32_t id;
+		size_t size;
+	};
+
+	struct Chunk {
+		std::unique_ptr<unsigned char[]> memory;
+		uint32_t count = 0;
+	};
+
+	// one chunk holds the entity handles first, then one 16-byte aligned array per component type
+	struct Archetype {
+		uint64_t mask = 0;
+		std::vector<ComponentType> types;
+		std::vector<size_t> offsets;
+		uint32_t capacity = 0;
+		size_t chunkBytes = 0;
+		std::vector<Chunk> chunks;
+
+		size_t column(uint32_t id) const {
+			size_t c = 0;
+			while (types[c].id != id) c++;
+			return c;
+		}
+
+		unsigned char* component(Chunk& chunk, uint32_t id, uint32_t row) {
+			const size_t c = column(id);
+			return chunk.memory.get() + offsets[c] + row * types[c].size;
+		}
+
+		Chunk newChunk() const {
+			Chunk chunk;
+			chunk.memory.reset(new unsigned char[chunkBytes]);
+			return chunk;
+		}
+	};
+
+	struct Record {
+		uint32_t archetype = 0, chunk = 0, row = 0;
+		uint32_t generation = 0;
+		bool alive = false;
+	};
+
+	std::vector<Archetype> archetypes;
+	std::vector<Record> records;
+	std::vector<uint32_t> freeRecords;
+	size_t alive = 0;
+
+	template<typename T>
+	static uint64_t componentBit() {
+		return 1ull << componentId<T>();
+	}
+
+	template<typename... Components>
+	Archetype& archetypeFor() {
+		const uint64_t mask = (componentBit<Components>() | ...);
+		for (auto& archetype : archetypes) {
+			if (archetype.mask == mask) return archetype;
+		}
+		Archetype archetype;
+		archetype.mask = mask;
+		archetype.types = { ComponentType{ componentId<Components>(), sizeof(Components) }... };
+		size_t rowBytes = sizeof(Entity);
+		for (const auto& type : archetype.types) rowBytes += type.size;
+		// leave room for the alignment padding in front of every array
+		archetype.capacity = (uint32_t)std::max<size_t>(1, (ECS_CHUNK_BYTES - 16 * archetype.types.size()) / rowBytes);
+		size_t offset = sizeof(Entity) * archetype.capacity;
+		for (const auto& type : archetype.types) {
+			offset = (offset + 15) / 16 * 16;
+			archetype.offsets.push_back(offset);
+			offset += type.size * archetype.capacity;
+		}
+		archetype.chunkBytes = offset;
+		archetypes.push_back(std::move(archetype));
+		return archetypes.back();
+	}
+
+	template<typename... Components, typename F, size_t... I>
+	static void callChunk(F& f, Chunk& chunk, const size_t* offsets, std::index_sequence<I...>) {
+		f(chunk.count, (const Entity*)chunk.memory.get(), (Components*)(chunk.memory.get() + offsets[I])...);
+	}
+};
+
+#endif
@@ -0,0 +1,109 @@
+#pragma once
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// reports files that were written since the last poll; inotify on Linux, modification time polling elsewhere
+class FileWatcher {
+public:
+	FileWatcher() {
+#ifdef __linux__
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+	}
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	void watch(const std::string& path) {
+		const std::string key = normalize(path);
+		if (files.count(key)) return;
+		files[key] = path;
+#ifdef __linux__
+		if (fd < 0) return;
+		// editors often replace files by rename, so the directory is watched rather than the file
+		const std::string directory = std::filesystem::path(key).parent_path().string();
+		for (const auto& watched : directories) {
+			if (watched.second == directory) return;
+		}
+		const int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (wd >= 0) directories[wd] = directory;
+#else
+		std::error_code error;
+		timestamps[key] = std::filesystem::last_write_time(key, error);
+#endif
+	}
+
+	// never blocks; every changed path is reported once, as it was passed to watch()
+	std::vector<std::string> poll() {
+		std::vector<std::string> changed;
+#ifdef __linux__
+		if (fd < 0) return changed;
+		alignas(inotify_event) char buffer[4096];
+		for (;;) {
+			const ssize_t length = read(fd, buffer, sizeof(buffer));
+			if (length <= 0) break;
+			for (ssize_t offset = 0; offset < length;) {
+				const auto event = (const inotify_event*)(buffer + offset);
+				offset += sizeof(inotify_event) + event->len;
+				const auto directory = directories.find(event->wd);
+				if (event->len == 0 || directory == directories.end()) continue;
+				const auto file = files.find(normalize(directory->second + "/" + event->name));
+				if (file != files.end()) changed.push_back(file->second);
+			}
+		}
+#else
+		// a few checks per second are plenty for edits made by hand
+		const auto now = std::chrono::steady_clock::now();
+		if (now - lastPoll < std::chrono::milliseconds(250)) return changed;
+		lastPoll = now;
+		for (auto& entry : timestamps) {
+			std::error_code error;
+			const auto time = std::filesystem::last_write_time(entry.first, error);
+			if (error || time == entry.second) continue;
+			entry.second = time;
+			changed.push_back(files[entry.first]);
+		}
+#endif
+		std::sort(changed.begin(), changed.end());
+		changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+		return changed;
+	}
+
+	~FileWatcher() {
+#ifdef __linux__
+		if (fd >= 0) close(fd);
+#endif
+	}
+
+private:
+	// normalized path -> path as passed to watch()
+	std::unordered_map<std::string, std::string> files;
+#ifdef __linux__
+	int fd = -1;
+	std::unordered_map<int, std::string> directories;
+#else
+	std::unordered_map<std::string, std::filesystem::file_time_type> timestamps;
+	std::chrono::steady_clock::time_point lastPoll;
+#endif
+
+	static std::string normalize(const std::string& path) {
+		std::error_code error;
+		const auto absolute = std::filesystem::absolute(path, error);
+		return (error ? std::filesystem::path(path) : absolute).lexically_normal().string();
+	}
+};
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <algorithm>
+
+// accumulator for a simulation that always advances in steps of the same length, whatever the frame rate:
+// every frame adds its duration, and as many whole steps as fit are taken out. The remainder is how far the
+// frame lies between the last two simulated states. After a spike only maxSteps are run and the rest of the
+// time is dropped, so one slow frame cannot start a spiral of ever longer catch-up frames
+class FixedTimestep {
+public:
+	struct Stats {
+		unsigned int steps = 0;
+		double droppedSeconds = 0;
+	};
+
+	explicit FixedTimestep(double step = 1.0 / 60.0, unsigned int maxSteps = 8) : stepSeconds(step), maxSteps(std::max(1u, maxSteps)) {}
+
+	// number of steps to simulate for a frame that took frameSeconds
+	unsigned int advance(double frameSeconds) {
+		accumulator += std::max(0.0, frameSeconds);
+		const double limit = stepSeconds * maxSteps;
+		if (accumulator > limit + stepSeconds) {
+			stats.droppedSeconds += accumulator - limit;
+			accumulator = limit;
+		}
+		unsigned int steps = 0;
+		while (accumulator >= stepSeconds) {
+			accumulator -= stepSeconds;
+			steps++;
+		}
+		stats.steps += steps;
+		return steps;
+	}
+
+	// where between the previous and the current simulated state this frame is drawn, in [0, 1)
+	float alpha() const {
+		return (float)(accumulator / stepSeconds);
+	}
+
+	double step() const {
+		return stepSeconds;
+	}
+
+	// steps and dropped time since the last call
+	Stats frameStats() {
+		const Stats result = stats;
+		stats = Stats();
+		return result;
+	}
+
+private:
+	double stepSeconds;
+	unsigned int maxSteps;
+	double accumulator = 0;
+	Stats stats;
+};
+
+#endif
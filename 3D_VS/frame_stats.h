@@ -0,0 +1,120 @@
+#pragma once
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// per-frame CPU and GPU times of a benchmark run, summarized as min/mean/percentiles and a histogram and
+// written as JSON for comparing builds. GPU times arrive a few frames late, so they are set by frame index
+class FrameStats {
+public:
+	static constexpr double BUCKET_MS = 0.5;
+	static constexpr size_t BUCKETS = 100;
+
+	struct Summary {
+		double min = 0, mean = 0, p50 = 0, p95 = 0, p99 = 0, max = 0;
+	};
+
+	explicit FrameStats(size_t frames = 0) {
+		cpu.reserve(frames);
+		gpu.reserve(frames);
+	}
+
+	// returns the frame's index for setGpu()
+	size_t addCpu(double milliseconds) {
+		cpu.push_back(milliseconds);
+		gpu.push_back(-1.0);
+		return cpu.size() - 1;
+	}
+
+	void setGpu(size_t frame, double milliseconds) {
+		if (frame < gpu.size()) gpu[frame] = milliseconds;
+	}
+
+	size_t frames() const {
+		return cpu.size();
+	}
+
+	Summary cpuSummary() const {
+		return summarize(cpu);
+	}
+
+	Summary gpuSummary() const {
+		return summarize(gpu);
+	}
+
+	// fields are written in a fixed order with fixed formatting, so two runs diff cleanly
+	bool writeJson(const std::string& path, const std::string& scene, size_t warmup, double simulationRate, const std::string& renderer) const {
+		FILE* file = fopen(path.c_str(), "w");
+		if (file == NULL) {
+			std::cout << "ERROR::FRAME_STATS::FAILED_TO_WRITE: " << path << std::endl;
+			return false;
+		}
+		fprintf(file, "{\n  \"scene\": \"%s\",\n  \"renderer\": \"%s\",\n  \"frames\": %zu,\n  \"warmup\": %zu,\n  \"simulation_rate\": %.3f,\n",
+			escape(scene).c_str(), escape(renderer).c_str(), cpu.size(), warmup, simulationRate);
+		writeSummary(file, "cpu_ms", cpuSummary());
+		writeSummary(file, "gpu_ms", gpuSummary());
+		fprintf(file, "  \"histogram\": {\n    \"bucket_ms\": %.3f,\n", BUCKET_MS);
+		writeHistogram(file, "cpu", cpu, ",");
+		writeHistogram(file, "gpu", gpu, "");
+		fprintf(file, "  }\n}\n");
+		fclose(file);
+		return true;
+	}
+
+private:
+	std::vector<double> cpu;
+	// negative until the frame's query result came back
+	std::vector<double> gpu;
+
+	// nearest-rank percentiles over the frames that have a time
+	static Summary summarize(const std::vector<double>& times) {
+		std::vector<double> sorted;
+		for (double time : times) {
+			if (time >= 0) sorted.push_back(time);
+		}
+		Summary summary;
+		if (sorted.empty()) return summary;
+		std::sort(sorted.begin(), sorted.end());
+		const auto percentile = [&](double p) { return sorted[std::min(sorted.size() - 1, (size_t)(p / 100.0 * sorted.size()))]; };
+		summary.min = sorted.front();
+		summary.max = sorted.back();
+		for (double time : sorted) summary.mean += time;
+		summary.mean /= sorted.size();
+		summary.p50 = percentile(50);
+		summary.p95 = percentile(95);
+		summary.p99 = percentile(99);
+		return summary;
+	}
+
+	static void writeSummary(FILE* file, const char* name, const Summary& s) {
+		fprintf(file, "  \"%s\": { \"min\": %.4f, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+			name, s.min, s.mean, s.p50, s.p95, s.p99, s.max);
+	}
+
+	// the last bucket also counts every frame beyond it
+	static void writeHistogram(FILE* file, const char* name, const std::vector<double>& times, const char* separator) {
+		std::vector<size_t> counts(BUCKETS, 0);
+		for (double time : times) {
+			if (time >= 0) counts[std::min(BUCKETS - 1, (size_t)(time / BUCKET_MS))]++;
+		}
+		fprintf(file, "    \"%s\": [", name);
+		for (size_t b = 0; b < BUCKETS; b++) fprintf(file, b ? ", %zu" : "%zu", counts[b]);
+		fprintf(file, "]%s\n", separator);
+	}
+
+	static std::string escape(const std::string& text) {
+		std::string result;
+		for (char c : text) {
+			if (c == '"' || c == '\\') result += '\\';
+			if ((unsigned char)c >= 0x20) result += c;
+		}
+		return result;
+	}
+};
+
+#endif
@@ -0,0 +1,217 @@
+#pragma once
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "job_system.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLING_SSE
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define FRUSTUM_CULLING_AVX2
+#include <immintrin.h>
+#endif
+
+// the six planes of a view-projection matrix (Gribb/Hartmann), normalized and pointing inwards
+struct Frustum {
+	glm::vec4 planes[6];
+
+	static Frustum fromMatrix(const glm::mat4& viewProjection) {
+		const glm::mat4& m = viewProjection;
+		const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+		Frustum frustum;
+		frustum.planes[0] = row3 + row0; // left
+		frustum.planes[1] = row3 - row0; // right
+		frustum.planes[2] = row3 + row1; // bottom
+		frustum.planes[3] = row3 - row1; // top
+		frustum.planes[4] = row3 + row2; // near
+		frustum.planes[5] = row3 - row2; // far
+		// an infinite projection has no far plane: its row is (0, 0, 0, d > 0), which every box passes as it is
+		for (auto& plane : frustum.planes) {
+			const float length = glm::length(glm::vec3(plane));
+			if (length > 0.f) plane /= length;
+		}
+		return frustum;
+	}
+};
+
+// world-space axis aligned boxes as center and half extent, one array per component so a batch of boxes
+// loads straight into SIMD registers
+class CullBounds {
+public:
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+
+	size_t size() const {
+		return centerX.size();
+	}
+
+	void resize(size_t count) {
+		for (auto* component : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ }) component->resize(count);
+	}
+
+	void set(size_t index, const glm::vec3& center, const glm::vec3& extent) {
+		centerX[index] = center.x;
+		centerY[index] = center.y;
+		centerZ[index] = center.z;
+		extentX[index] = extent.x;
+		extentY[index] = extent.y;
+		extentZ[index] = extent.z;
+	}
+
+	void push_back(const glm::vec3& center, const glm::vec3& extent) {
+		resize(size() + 1);
+		set(size() - 1, center, extent);
+	}
+};
+
+enum class CullPath {
+	Scalar,
+	SSE,
+	AVX2
+};
+
+// widest path compiled in; AVX2 needs /arch:AVX2 (or -mavx2), SSE2 is always there on x64
+inline CullPath bestCullPath() {
+#if defined(FRUSTUM_CULLING_AVX2)
+	return CullPath::AVX2;
+#elif defined(FRUSTUM_CULLING_SSE)
+	return CullPath::SSE;
+#else
+	return CullPath::Scalar;
+#endif
+}
+
+inline const char* cullPathName(CullPath path) {
+	switch (path) {
+	case CullPath::AVX2: return "AVX2";
+	case CullPath::SSE: return "SSE";
+	default: return "scalar";
+	}
+}
+
+// a box is culled when it lies fully behind any plane: center distance plus projected extent below zero
+inline bool boxInFrustum(const Frustum& frustum, const CullBounds& bounds, size_t i) {
+	for (const auto& plane : frustum.planes) {
+		const float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+		const float radius = std::fabs(plane.x) * bounds.extentX[i] + std::fabs(plane.y) * bounds.extentY[i] + std::fabs(plane.z) * bounds.extentZ[i];
+		if (distance + radius < 0.f) return false;
+	}
+	return true;
+}
+
+// writes the indices of the boxes in [begin, end) touching the frustum to out (compacted, in order) and returns
+// how many there are; batches write all lanes and only advance past the visible ones, so there is no branch per
+// box. Nothing is written past out + (end - begin)
+inline size_t cullFrustumRange(const Frustum& frustum, const CullBounds& bounds, size_t begin, size_t end, uint32_t* out, CullPath path = bestCullPath()) {
+	const size_t count = end;
+	size_t written = 0, i = begin;
+
+#if defined(FRUSTUM_CULLING_AVX2)
+	if (path == CullPath::AVX2) {
+		__m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+		const __m256 signMask = _mm256_set1_ps(-0.f);
+		for (int p = 0; p < 6; p++) {
+			planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+			planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+			planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+			planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+			absX[p] = _mm256_andnot_ps(signMask, planeX[p]);
+			absY[p] = _mm256_andnot_ps(signMask, planeY[p]);
+			absZ[p] = _mm256_andnot_ps(signMask, planeZ[p]);
+		}
+		const __m256 zero = _mm256_setzero_ps();
+		for (; i + 8 <= count; i += 8) {
+			const __m256 cx = _mm256_loadu_ps(&bounds.centerX[i]), cy = _mm256_loadu_ps(&bounds.centerY[i]), cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+			const __m256 ex = _mm256_loadu_ps(&bounds.extentX[i]), ey = _mm256_loadu_ps(&bounds.extentY[i]), ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)), _mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), planeW[p]));
+				const __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey)), _mm256_mul_ps(absZ[p], ez));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+			}
+			const unsigned int mask = (unsigned int)_mm256_movemask_ps(inside);
+			for (unsigned int lane = 0; lane < 8; lane++) {
+				out[written] = (uint32_t)(i + lane);
+				written += (mask >> lane) & 1;
+			}
+		}
+	}
+#endif
+#if defined(FRUSTUM_CULLING_SSE)
+	if (path == CullPath::SSE || path == CullPath::AVX2) {
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+		const __m128 signMask = _mm_set1_ps(-0.f);
+		for (int p = 0; p < 6; p++) {
+			planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+			planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+			planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+			planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+			absX[p] = _mm_andnot_ps(signMask, planeX[p]);
+			absY[p] = _mm_andnot_ps(signMask, planeY[p]);
+			absZ[p] = _mm_andnot_ps(signMask, planeZ[p]);
+		}
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4) {
+			const __m128 cx = _mm_loadu_ps(&bounds.centerX[i]), cy = _mm_loadu_ps(&bounds.centerY[i]), cz = _mm_loadu_ps(&bounds.centerZ[i]);
+			const __m128 ex = _mm_loadu_ps(&bounds.extentX[i]), ey = _mm_loadu_ps(&bounds.extentY[i]), ez = _mm_loadu_ps(&bounds.extentZ[i]);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)), _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+				const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+			}
+			const unsigned int mask = (unsigned int)_mm_movemask_ps(inside);
+			for (unsigned int lane = 0; lane < 4; lane++) {
+				out[written] = (uint32_t)(i + lane);
+				written += (mask >> lane) & 1;
+			}
+		}
+	}
+#endif
+	// scalar path and the tail of the SIMD batches
+	for (; i < count; i++) {
+		out[written] = (uint32_t)i;
+		written += boxInFrustum(frustum, bounds, i) ? 1 : 0;
+	}
+	return written;
+}
+
+// indices of every box touching the frustum into visible, in order, and how many there are
+inline size_t cullFrustum(const Frustum& frustum, const CullBounds& bounds, std::vector<uint32_t>& visible, CullPath path = bestCullPath()) {
+	visible.resize(bounds.size());
+	visible.resize(cullFrustumRange(frustum, bounds, 0, bounds.size(), visible.data(), path));
+	return visible.size();
+}
+
+// the same split into ranges across the job system's threads; every range culls into its own part of visible,
+// which is compacted afterwards
+inline size_t cullFrustum(const Frustum& frustum, const CullBounds& bounds, std::vector<uint32_t>& visible, JobSystem& jobs, CullPath path = bestCullPath()) {
+	const size_t grain = 16384;
+	const size_t count = bounds.size();
+	if (count <= grain * 2 || jobs.threadCount() == 1) return cullFrustum(frustum, bounds, visible, path);
+	visible.resize(count);
+	std::vector<size_t> written((count + grain - 1) / grain);
+	jobs.parallelFor(count, grain, [&](size_t begin, size_t end) { written[begin / grain] = cullFrustumRange(frustum, bounds, begin, end, visible.data() + begin, path); });
+	size_t total = written[0];
+	for (size_t r = 1; r < written.size(); r++) {
+		std::memmove(visible.data() + total, visible.data() + r * grain, written[r] * sizeof(uint32_t));
+		total += written[r];
+	}
+	visible.resize(total);
+	return total;
+}
+
+#endif
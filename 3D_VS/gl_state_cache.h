@@ -0,0 +1,102 @@
+#pragma once
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// shadow copy of the bindings the draw path changes, so binding what is already bound costs no GL call.
+// Code that binds through GL directly leaves the copy stale; call invalidate() after it
+class GlStateCache {
+public:
+	// GL calls issued and calls dropped as redundant since the last frameStats()
+	struct Stats {
+		unsigned int programChanges = 0;
+		unsigned int vertexArrayChanges = 0;
+		unsigned int bufferChanges = 0;
+		unsigned int skipped = 0;
+	};
+
+	void useProgram(GLuint program) {
+		if (program == currentProgram) {
+			stats.skipped++;
+			return;
+		}
+		glUseProgram(program);
+		currentProgram = program;
+		stats.programChanges++;
+	}
+
+	void bindVertexArray(GLuint vertexArray) {
+		if (vertexArray == currentVertexArray) {
+			stats.skipped++;
+			return;
+		}
+		glBindVertexArray(vertexArray);
+		currentVertexArray = vertexArray;
+		stats.vertexArrayChanges++;
+	}
+
+	// vertex buffer bindings are vertex array state, so they are remembered per vertex array
+	void bindVertexBuffer(GLuint binding, GLuint buffer, GLintptr offset, GLsizei stride) {
+		Binding key = { GL_VERTEX_ARRAY, currentVertexArray, binding };
+		if (bind(key, buffer, offset, stride)) glBindVertexBuffer(binding, buffer, offset, stride);
+	}
+
+	void invalidate() {
+		currentProgram = INVALID;
+		currentVertexArray = INVALID;
+		bindings.clear();
+	}
+
+	Stats frameStats() {
+		const Stats result = stats;
+		stats = Stats();
+		return result;
+	}
+
+private:
+	// no GL object has this name, so the first bind after invalidate() always goes through
+	static const GLuint INVALID = 0xFFFFFFFFu;
+
+	struct Binding {
+		GLenum target;
+		GLuint owner;
+		GLuint index;
+	};
+
+	struct BoundBuffer {
+		Binding key;
+		GLuint buffer;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+
+	GLuint currentProgram = INVALID;
+	GLuint currentVertexArray = INVALID;
+	// a handful per frame, a linear search beats any map
+	std::vector<BoundBuffer> bindings;
+	Stats stats;
+
+	// records the binding and tells whether it differs from what is bound
+	bool bind(const Binding& key, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+		for (auto& bound : bindings) {
+			if (bound.key.target != key.target || bound.key.owner != key.owner || bound.key.index != key.index) continue;
+			if (bound.buffer == buffer && bound.offset == offset && bound.size == size) {
+				stats.skipped++;
+				return false;
+			}
+			bound.buffer = buffer;
+			bound.offset = offset;
+			bound.size = size;
+			stats.bufferChanges++;
+			return true;
+		}
+		bindings.push_back({ key, buffer, offset, size });
+		stats.bufferChanges++;
+		return true;
+	}
+};
+
+#endif
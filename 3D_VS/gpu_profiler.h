@@ -0,0 +1,152 @@
+#pragma once
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "profiler.h"
+
+// GPU zones as pairs of glQueryCounter timestamps, so zones can nest, unlike GL_TIME_ELAPSED queries. Every
+// frame writes its own set of queries and reads the set of FRAMES frames ago, whose results have long
+// arrived, so reading never stalls; a set that is still not done then is dropped rather than waited for.
+// Times land on a "GPU" track of the profiler, shifted onto the CPU clock by an offset taken at start
+class GpuProfiler {
+public:
+	static const unsigned int FRAMES = 3;
+
+	GpuProfiler() {
+		track = Profiler::addTrack("GPU");
+		GLint64 gpuNow = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+		offset = Profiler::now() - gpuNow;
+		current() = this;
+	}
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	~GpuProfiler() {
+		current() = nullptr;
+		for (Frame& frame : frames) {
+			if (!frame.queries.empty()) glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+		}
+	}
+
+	// the profiler GPU zones record into, null when there is none
+	static GpuProfiler*& current() {
+		static GpuProfiler* profiler = nullptr;
+		return profiler;
+	}
+
+	// collects the frame that used this slot last, then starts recording into it
+	void beginFrame() {
+		frameIndex++;
+		Frame& frame = frames[frameIndex % FRAMES];
+		collect(frame);
+		frame.zones.clear();
+		frame.used = 0;
+	}
+
+	// returns the zone to pass to end()
+	size_t begin(const char* name) {
+		Frame& frame = frames[frameIndex % FRAMES];
+		frame.zones.push_back(Zone{ name, timestamp(frame), 0 });
+		return frame.zones.size() - 1;
+	}
+
+	void end(size_t zone) {
+		Frame& frame = frames[frameIndex % FRAMES];
+		frame.zones[zone].end = timestamp(frame);
+	}
+
+	// waits for and collects every frame still in flight, at the end of a capture
+	void finish() {
+		for (unsigned int k = 1; k <= FRAMES; k++) {
+			Frame& frame = frames[(frameIndex + k) % FRAMES];
+			collect(frame, true);
+			frame.zones.clear();
+			frame.used = 0;
+		}
+	}
+
+	// sets still in flight are dropped, not waited for
+	size_t droppedFrames() const {
+		return dropped;
+	}
+
+private:
+	struct Zone {
+		const char* name;
+		unsigned int begin, end;
+	};
+
+	// queries grow to the most zones a frame ever had and are reused from then on
+	struct Frame {
+		std::vector<GLuint> queries;
+		unsigned int used = 0;
+		std::vector<Zone> zones;
+	};
+
+	Frame frames[FRAMES];
+	uint64_t frameIndex = 0;
+	Profiler::Track* track = nullptr;
+	int64_t offset = 0;
+	size_t dropped = 0;
+
+	unsigned int timestamp(Frame& frame) {
+		if (frame.used == frame.queries.size()) {
+			GLuint query = 0;
+			glGenQueries(1, &query);
+			frame.queries.push_back(query);
+		}
+		glQueryCounter(frame.queries[frame.used], GL_TIMESTAMP);
+		return frame.used++;
+	}
+
+	// the last query of a frame finishes last, so once it is available all of them are
+	void collect(const Frame& frame, bool wait = false) {
+		if (frame.zones.empty()) return;
+		GLint available = GL_FALSE;
+		if (!wait) glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!wait && !available) {
+			dropped++;
+			return;
+		}
+		for (const Zone& zone : frame.zones) {
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(frame.queries[zone.begin], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(frame.queries[zone.end], GL_QUERY_RESULT, &end);
+			if (track != nullptr) track->record(zone.name, (int64_t)begin + offset, (int64_t)end + offset);
+		}
+	}
+};
+
+// times the GPU work issued in the enclosing scope, when a GpuProfiler exists
+class GpuProfileZone {
+public:
+	explicit GpuProfileZone(const char* name) : profiler(GpuProfiler::current()) {
+		if (profiler != nullptr) zone = profiler->begin(name);
+	}
+
+	GpuProfileZone(const GpuProfileZone&) = delete;
+	GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+
+	~GpuProfileZone() {
+		if (profiler != nullptr) profiler->end(zone);
+	}
+
+private:
+	GpuProfiler* profiler;
+	size_t zone = 0;
+};
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_GPU_ZONE(name) GpuProfileZone PROFILE_CONCAT(gpuProfileZone, __LINE__)(name)
+#else
+#define PROFILE_GPU_ZONE(name) ((void)0)
+#endif
+
+#endif
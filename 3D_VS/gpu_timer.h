@@ -0,0 +1,68 @@
+#pragma once
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// GPU time of whole frames through GL_TIME_ELAPSED queries; a small ring of queries is read a few frames
+// later, once the results are there, so measuring never stalls the pipeline. Queries cannot nest, so only
+// one frame is measured at a time
+class GpuFrameTimer {
+public:
+	static const unsigned int QUERIES = 4;
+
+	GpuFrameTimer() {
+		glGenQueries(QUERIES, queries);
+	}
+
+	GpuFrameTimer(const GpuFrameTimer&) = delete;
+	GpuFrameTimer& operator=(const GpuFrameTimer&) = delete;
+
+	~GpuFrameTimer() {
+		glDeleteQueries(QUERIES, queries);
+	}
+
+	// the ring is full only when the GPU is QUERIES frames behind; then the oldest result is waited for
+	template<typename F>
+	void begin(uint64_t frame, F&& onResult) {
+		const unsigned int slot = (unsigned int)(issued % QUERIES);
+		if (issued - collected == QUERIES) read(slot, onResult);
+		frames[slot] = frame;
+		glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+	}
+
+	void end() {
+		glEndQuery(GL_TIME_ELAPSED);
+		issued++;
+	}
+
+	// calls onResult(frame, milliseconds) for every finished frame, oldest first; with wait, for all of them
+	template<typename F>
+	void collect(F&& onResult, bool wait = false) {
+		while (collected < issued) {
+			const unsigned int slot = (unsigned int)(collected % QUERIES);
+			GLint available = GL_FALSE;
+			if (!wait) glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!wait && !available) return;
+			read(slot, onResult);
+		}
+	}
+
+private:
+	GLuint queries[QUERIES];
+	uint64_t frames[QUERIES] = {};
+	uint64_t issued = 0;
+	uint64_t collected = 0;
+
+	template<typename F>
+	void read(unsigned int slot, F& onResult) {
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &nanoseconds);
+		onResult(frames[slot], nanoseconds / 1e6);
+		collected++;
+	}
+};
+
+#endif
@@ -0,0 +1,203 @@
+#pragma once
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+// what the engine does with input, independent of the keys that trigger it
+enum class InputAction {
+	MoveForward,
+	MoveBackward,
+	MoveLeft,
+	MoveRight,
+	Quit,
+	Count
+};
+
+// one GLFW callback, stamped with glfwGetTime() when it arrived
+struct InputEvent {
+	enum class Type { Key, MouseMove, Scroll, FocusLost };
+	Type type;
+	int key;
+	int action;
+	double x, y;
+	double time;
+};
+
+// buffered input: GLFW callbacks only append timestamped events, and beginFrame() replays them in order into
+// action states, a mouse delta and a scroll amount for the frame. Keys reach actions through a binding table,
+// so nothing else polls glfwGetKey. The oldest event a frame consumed is compared with the time the frame
+// was presented, which gives the input-to-present latency of that frame
+class InputSystem {
+public:
+	struct Stats {
+		unsigned int frames = 0;
+		double totalMilliseconds = 0;
+		double maxMilliseconds = 0;
+	};
+
+	// takes over the window's key, cursor, scroll and focus callbacks; raw motion skips the OS pointer
+	// acceleration, GLFW only offers it while the cursor is disabled
+	InputSystem(GLFWwindow* window, bool rawMotion) : window(window) {
+		bindings.fill(-1);
+		bind(GLFW_KEY_W, InputAction::MoveForward);
+		bind(GLFW_KEY_UP, InputAction::MoveForward);
+		bind(GLFW_KEY_S, InputAction::MoveBackward);
+		bind(GLFW_KEY_DOWN, InputAction::MoveBackward);
+		bind(GLFW_KEY_A, InputAction::MoveLeft);
+		bind(GLFW_KEY_LEFT, InputAction::MoveLeft);
+		bind(GLFW_KEY_D, InputAction::MoveRight);
+		bind(GLFW_KEY_RIGHT, InputAction::MoveRight);
+		bind(GLFW_KEY_ESCAPE, InputAction::Quit);
+
+		glfwSetWindowUserPointer(window, this);
+		glfwSetKeyCallback(window, keyCallback);
+		glfwSetCursorPosCallback(window, cursorCallback);
+		glfwSetScrollCallback(window, scrollCallback);
+		glfwSetWindowFocusCallback(window, focusCallback);
+		rawMouseMotion = rawMotion && glfwRawMouseMotionSupported();
+		if (rawMouseMotion) glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+	}
+
+	InputSystem(const InputSystem&) = delete;
+	InputSystem& operator=(const InputSystem&) = delete;
+
+	~InputSystem() {
+		glfwSetKeyCallback(window, nullptr);
+		glfwSetCursorPosCallback(window, nullptr);
+		glfwSetScrollCallback(window, nullptr);
+		glfwSetWindowFocusCallback(window, nullptr);
+		glfwSetWindowUserPointer(window, nullptr);
+	}
+
+	// a key triggers at most one action, binding it again replaces the old one
+	void bind(int key, InputAction action) {
+		if (key >= 0 && key <= GLFW_KEY_LAST) bindings[key] = (int)action;
+	}
+
+	bool rawMotion() const {
+		return rawMouseMotion;
+	}
+
+	// consumes every event queued since the last frame
+	void beginFrame() {
+		mouse[0] = mouse[1] = 0.f;
+		wheel = 0.f;
+		pressedActions.fill(false);
+		frameInputTime = -1.0;
+		for (const InputEvent& event : events) {
+			if (frameInputTime < 0.0) frameInputTime = event.time;
+			switch (event.type) {
+			case InputEvent::Type::Key: {
+				const int action = event.key >= 0 && event.key <= GLFW_KEY_LAST ? bindings[event.key] : -1;
+				if (action < 0 || event.action == GLFW_REPEAT) break;
+				const bool down = event.action == GLFW_PRESS;
+				if (down && !heldActions[action]) pressedActions[action] = true;
+				heldActions[action] = down;
+				break;
+			}
+			case InputEvent::Type::MouseMove:
+				// the first position only anchors the deltas
+				if (!firstMouse) {
+					mouse[0] += (float)(event.x - lastX);
+					mouse[1] += (float)(lastY - event.y); // reversed since y-coordinates go from bottom to top
+				}
+				firstMouse = false;
+				lastX = event.x;
+				lastY = event.y;
+				break;
+			case InputEvent::Type::Scroll:
+				wheel += (float)event.y;
+				break;
+			case InputEvent::Type::FocusLost:
+				// releases are not delivered to an unfocused window, so nothing may stay held
+				heldActions.fill(false);
+				firstMouse = true;
+				break;
+			}
+		}
+		events.clear();
+	}
+
+	bool held(InputAction action) const {
+		return heldActions[(int)action];
+	}
+
+	// went down during the last frame
+	bool pressed(InputAction action) const {
+		return pressedActions[(int)action];
+	}
+
+	float mouseX() const {
+		return mouse[0];
+	}
+
+	float mouseY() const {
+		return mouse[1];
+	}
+
+	float scroll() const {
+		return wheel;
+	}
+
+	// call once the frame that consumed the input is presented; presentTime on the glfwGetTime() clock
+	void presented(double presentTime) {
+		if (frameInputTime < 0.0) return;
+		const double milliseconds = (presentTime - frameInputTime) * 1000.0;
+		stats.frames++;
+		stats.totalMilliseconds += milliseconds;
+		stats.maxMilliseconds = std::max(stats.maxMilliseconds, milliseconds);
+		frameInputTime = -1.0;
+	}
+
+	// latency of the frames that had input since the last call
+	Stats frameStats() {
+		const Stats result = stats;
+		stats = Stats();
+		return result;
+	}
+
+private:
+	GLFWwindow* window;
+	bool rawMouseMotion = false;
+	std::vector<InputEvent> events;
+	std::array<int, GLFW_KEY_LAST + 1> bindings;
+	std::array<bool, (size_t)InputAction::Count> heldActions = {};
+	std::array<bool, (size_t)InputAction::Count> pressedActions = {};
+	bool firstMouse = true;
+	double lastX = 0, lastY = 0;
+	float mouse[2] = {};
+	float wheel = 0.f;
+	double frameInputTime = -1.0;
+	Stats stats;
+
+	void push(InputEvent::Type type, int key, int action, double x, double y) {
+		events.push_back(InputEvent{ type, key, action, x, y, glfwGetTime() });
+	}
+
+	static InputSystem* from(GLFWwindow* window) {
+		return static_cast<InputSystem*>(glfwGetWindowUserPointer(window));
+	}
+
+	static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+		if (InputSystem* input = from(window)) input->push(InputEvent::Type::Key, key, action, 0, 0);
+	}
+
+	static void cursorCallback(GLFWwindow* window, double x, double y) {
+		if (InputSystem* input = from(window)) input->push(InputEvent::Type::MouseMove, 0, 0, x, y);
+	}
+
+	static void scrollCallback(GLFWwindow* window, double x, double y) {
+		if (InputSystem* input = from(window)) input->push(InputEvent::Type::Scroll, 0, 0, x, y);
+	}
+
+	static void focusCallback(GLFWwindow* window, int focused) {
+		if (InputSystem* input = from(window); input != nullptr && !focused) input->push(InputEvent::Type::FocusLost, 0, 0, 0, 0);
+	}
+};
+
+#endif
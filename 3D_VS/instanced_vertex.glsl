@@ -0,0 +1,19 @@
+#version 450 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in vec4 aInstanceColor;
+out vec3 ourColor;
+
+layout (std140, binding = 0) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+};
+
+void main() {
+    gl_Position = viewProjection * aModel * vec4(aPos, 1.0);
+    ourColor = aColor * aInstanceColor.rgb;
+}
\ No newline at end of file
@@ -0,0 +1,235 @@
+#pragma once
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "profiler.h"
+
+class JobSystem;
+
+// counts the unfinished jobs of a group; wait() on it, or start jobs after it with run(..., after).
+// A counter can be reused or destroyed once wait() on it returned
+class JobCounter {
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool done() const {
+		return pending.load(std::memory_order_acquire) == 0;
+	}
+
+private:
+	friend class JobSystem;
+
+	struct Continuation {
+		std::function<void()> function;
+		JobCounter* counter;
+	};
+
+	std::atomic<uint32_t> pending{ 0 };
+	std::mutex mutex;
+	std::vector<Continuation> continuations;
+};
+
+// fixed pool of worker threads, each with its own deque: a thread pushes and pops jobs at the back of its own
+// deque, and when that is empty steals from the front of the others, so related jobs stay on one core and
+// idle cores take the oldest, usually largest, work. The thread that created the pool owns deque 0 and runs
+// jobs while it waits, so it is never idle either; GL calls stay on that thread since jobs never issue any
+class JobSystem {
+public:
+	struct Stats {
+		size_t jobs = 0;
+		size_t steals = 0;
+	};
+
+	// threads counts the calling thread too, 0 uses every core
+	explicit JobSystem(unsigned int threads = 0) {
+		const unsigned int count = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+		for (unsigned int t = 0; t < count; t++) queues.push_back(std::make_unique<Queue>());
+		for (unsigned int t = 1; t < count; t++) workers.emplace_back([this, t]() { workerLoop(t); });
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	~JobSystem() {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& worker : workers) worker.join();
+	}
+
+	unsigned int threadCount() const {
+		return (unsigned int)queues.size();
+	}
+
+	// queues a job counted by counter; with after, it is only queued once that counter reaches zero
+	void run(std::function<void()> job, JobCounter& counter, JobCounter* after = nullptr) {
+		counter.pending.fetch_add(1, std::memory_order_relaxed);
+		if (after != nullptr) {
+			std::lock_guard<std::mutex> lock(after->mutex);
+			if (!after->done()) {
+				after->continuations.push_back({ std::move(job), &counter });
+				return;
+			}
+		}
+		push(Job{ std::move(job), &counter });
+	}
+
+	// runs queued jobs on the calling thread until counter reaches zero
+	void wait(JobCounter& counter) {
+		const unsigned int self = currentQueue();
+		while (!counter.done()) {
+			Job job;
+			if (take(self, job)) execute(job);
+			else std::this_thread::yield();
+		}
+		// the thread that finished the last job may still hold the lock while it takes the continuations
+		std::lock_guard<std::mutex> lock(counter.mutex);
+	}
+
+	// calls f(begin, end) over [0, count) in ranges of about grain items, spread over every thread, and
+	// returns when all of them are done
+	template<typename F>
+	void parallelFor(size_t count, size_t grain, F&& f) {
+		grain = std::max<size_t>(1, grain);
+		if (count <= grain || threadCount() == 1) {
+			if (count > 0) f((size_t)0, count);
+			return;
+		}
+		JobCounter counter;
+		for (size_t begin = grain; begin < count; begin += grain) {
+			const size_t end = std::min(count, begin + grain);
+			run([&f, begin, end]() { f(begin, end); }, counter);
+		}
+		f((size_t)0, grain);
+		wait(counter);
+	}
+
+	// jobs run and jobs stolen from another thread's deque since the last call
+	Stats statistics() {
+		Stats stats;
+		stats.jobs = executed.exchange(0, std::memory_order_relaxed);
+		stats.steals = stolen.exchange(0, std::memory_order_relaxed);
+		return stats;
+	}
+
+private:
+	struct Job {
+		std::function<void()> function;
+		JobCounter* counter = nullptr;
+	};
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+	std::atomic<size_t> queued{ 0 };
+	std::atomic<size_t> executed{ 0 };
+	std::atomic<size_t> stolen{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	// the pool and deque of the calling thread, so a job queued from a worker lands in that worker's deque
+	static const JobSystem*& currentPool() {
+		static thread_local const JobSystem* pool = nullptr;
+		return pool;
+	}
+
+	static unsigned int& currentIndex() {
+		static thread_local unsigned int index = 0;
+		return index;
+	}
+
+	unsigned int currentQueue() const {
+		return currentPool() == this ? currentIndex() : 0;
+	}
+
+	void push(Job job) {
+		Queue& queue = *queues[currentQueue()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(std::move(job));
+		}
+		queued.fetch_add(1, std::memory_order_release);
+		// taking the lock orders the push before a worker that is about to sleep checks queued
+		{ std::lock_guard<std::mutex> lock(sleepMutex); }
+		wake.notify_one();
+	}
+
+	// newest job of the own deque, else the oldest job of the next non-empty one
+	bool take(unsigned int self, Job& job) {
+		if (queued.load(std::memory_order_acquire) == 0) return false;
+		for (unsigned int k = 0; k < queues.size(); k++) {
+			const unsigned int victim = (self + k) % (unsigned int)queues.size();
+			Queue& queue = *queues[victim];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.jobs.empty()) continue;
+			if (k == 0) {
+				job = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+			}
+			else {
+				job = std::move(queue.jobs.front());
+				queue.jobs.pop_front();
+				stolen.fetch_add(1, std::memory_order_relaxed);
+			}
+			queued.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	}
+
+	// the last job of a group releases the jobs waiting on its counter; the count drops under the counter's
+	// lock, so a waiter cannot destroy the counter while it is still in use here
+	void execute(Job& job) {
+		{
+			PROFILE_ZONE("job");
+			job.function();
+		}
+		executed.fetch_add(1, std::memory_order_relaxed);
+		std::vector<JobCounter::Continuation> continuations;
+		{
+			JobCounter& counter = *job.counter;
+			std::lock_guard<std::mutex> lock(counter.mutex);
+			if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) continuations.swap(counter.continuations);
+		}
+		for (auto& continuation : continuations) push(Job{ std::move(continuation.function), continuation.counter });
+	}
+
+	void workerLoop(unsigned int index) {
+		currentPool() = this;
+		currentIndex() = index;
+		PROFILE_THREAD("worker " + std::to_string(index));
+		for (;;) {
+			Job job;
+			if (take(index, job)) {
+				execute(job);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wake.wait(lock, [this]() { return stopping || queued.load(std::memory_order_acquire) > 0; });
+			if (stopping) return;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+#ifndef LOD_SELECTION_H
+#define LOD_SELECTION_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+#include "mesh_format.h"
+
+// a coarser level is only taken once its error is this fraction of the limit, so objects sitting right at a
+// switching distance do not pop back and forth every frame
+const float LOD_HYSTERESIS = 0.75f;
+
+// pixels covered by one world unit seen from a distance of one, for a vertical field of view in degrees
+inline float lodPixelScale(float fovYDegrees, float viewportHeight) {
+	return viewportHeight / (2.f * std::tan(glm::radians(fovYDegrees) * 0.5f));
+}
+
+// the coarsest level whose error, projected at the given distance, stays within maxPixels; starts from the
+// level the object used last frame and refines as soon as that one is too coarse
+inline unsigned int selectLod(const MeshLod* lods, unsigned int lodCount, float distance, float pixelScale, float maxPixels, unsigned int current) {
+	if (lodCount == 0) return 0;
+	const float perPixel = pixelScale / std::max(distance, 1e-3f);
+	unsigned int lod = current < lodCount ? current : 0;
+	while (lod > 0 && lods[lod].error * perPixel > maxPixels) lod--;
+	while (lod + 1 < lodCount && lods[lod + 1].error * perPixel <= maxPixels * LOD_HYSTERESIS) lod++;
+	return lod;
+}
+
+#endif
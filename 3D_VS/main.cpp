@@ -1,7 +1,89 @@
 #include "MainEngine.h"
+#include "mesh_converter.h"
 
+#include <cstdlib>
+#include <cstring>
 
-int main() {
-	MainEngine MainEngine{};
+
+int main(int argc, char** argv) {
+	EngineConfig config{};
+	for (int i = 1; i < argc; i++) {
+		// --bench-instanced [count] draws a grid of instanced cubes, --no-instancing draws it one cube at a time
+		if (!strcmp(argv[i], "--bench-instanced")) {
+			config.benchInstances = 100000;
+			if (i + 1 < argc && argv[i + 1][0] != '-') config.benchInstances = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--no-instancing")) config.benchNoInstancing = true;
+		else if (!strcmp(argv[i], "--bench-uniforms")) config.benchUniforms = true;
+		else if (!strcmp(argv[i], "--no-shader-cache")) config.shaderCache = false;
+		else if (!strcmp(argv[i], "--no-hot-reload")) config.hotReload = false;
+		else if (!strcmp(argv[i], "--bench-layout")) {
+			config.benchLayout = 2000000;
+			if (i + 1 < argc && argv[i + 1][0] != '-') config.benchLayout = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--bench-cull")) {
+			config.benchCull = 1000000;
+			if (i + 1 < argc && argv[i + 1][0] != '-') config.benchCull = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--no-culling")) config.culling = false;
+		else if (!strcmp(argv[i], "--cull-bvh")) config.cullWithBvh = true;
+		else if (!strcmp(argv[i], "--occlusion")) config.occlusion = true;
+		else if (!strcmp(argv[i], "--bench-occlusion")) config.benchOcclusion = true;
+		// --bench-bvh [count] measures one size, without a count it sweeps 100k and 1M objects
+		else if (!strcmp(argv[i], "--bench-bvh")) {
+			config.benchBvh = 1;
+			if (i + 1 < argc && argv[i + 1][0] != '-') config.benchBvh = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--bench-mesh") && i + 1 < argc) config.benchMesh = argv[++i];
+		else if (!strcmp(argv[i], "--scene-mesh") && i + 1 < argc) config.sceneMesh = argv[++i];
+		else if (!strcmp(argv[i], "--no-lod")) config.lod = false;
+		else if (!strcmp(argv[i], "--lod-error") && i + 1 < argc) config.lodPixelError = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "--bench-ecs")) {
+			config.benchEcs = 1000000;
+			if (i + 1 < argc && argv[i + 1][0] != '-') config.benchEcs = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--static-objects")) config.staticObjects = true;
+		else if (!strcmp(argv[i], "--headless")) {
+			config.headless = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') config.headlessFrames = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--context-api") && i + 1 < argc) config.contextApi = argv[++i];
+		else if (!strcmp(argv[i], "--reverse-z")) config.reverseZ = true;
+		else if (!strcmp(argv[i], "--no-raw-mouse")) config.rawMouse = false;
+		else if (!strcmp(argv[i], "--dump-frame") && i + 1 < argc) config.dumpFrame = argv[++i];
+		else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+			config.traceFile = argv[++i];
+			if (i + 1 < argc && argv[i + 1][0] != '-') config.traceFrames = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--benchmark") && i + 1 < argc) config.benchmarkScene = argv[++i];
+		else if (!strcmp(argv[i], "--benchmark-frames") && i + 1 < argc) config.benchmarkFrames = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "--warmup") && i + 1 < argc) config.benchmarkWarmup = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "--benchmark-out") && i + 1 < argc) config.benchmarkOutput = argv[++i];
+		else if (!strcmp(argv[i], "--sim-rate") && i + 1 < argc) config.simulationRate = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "--bench-hierarchy")) {
+			config.benchHierarchy = 1000000;
+			if (i + 1 < argc && argv[i + 1][0] != '-') config.benchHierarchy = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--bench-jobs")) {
+			config.benchJobs = 1000000;
+			if (i + 1 < argc && argv[i + 1][0] != '-') config.benchJobs = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--bench-lod")) {
+			config.benchLod = 200000;
+			if (i + 1 < argc && argv[i + 1][0] != '-') config.benchLod = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (!strcmp(argv[i], "--bench-import")) {
+			config.benchImport = 2000000;
+			if (i + 1 < argc && argv[i + 1][0] != '-') config.benchImport = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		// offline conversion, no window or GL context needed
+		else if (!strcmp(argv[i], "--convert-mesh") && i + 2 < argc) {
+			// packed vertices unless "float" follows the output path
+			const bool floats = i + 3 < argc && !strcmp(argv[i + 3], "float");
+			return convertObjToMesh(argv[i + 1], argv[i + 2], floats ? VertexLayout::floats() : VertexLayout::packed()) ? 0 : 1;
+		}
+	}
+
+	MainEngine MainEngine{config};
 	return MainEngine.launch();
 }
@@ -0,0 +1,134 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// read-only memory mapping of a whole file; pages are only loaded when touched and released on close()
+class MappedFile {
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& path) {
+		open(path);
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& path) {
+		close();
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			close();
+			return false;
+		}
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			close();
+			return false;
+		}
+		bytes = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		length = (size_t)fileSize.QuadPart;
+#else
+		fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			close();
+			return false;
+		}
+		void* address = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (address == MAP_FAILED) {
+			close();
+			return false;
+		}
+		// files are read front to back once, so let the kernel read ahead aggressively
+		madvise(address, (size_t)info.st_size, MADV_SEQUENTIAL);
+		bytes = (const unsigned char*)address;
+		length = (size_t)info.st_size;
+#endif
+		if (bytes == nullptr) close();
+		return bytes != nullptr;
+	}
+
+	const unsigned char* data() const {
+		return bytes;
+	}
+
+	size_t size() const {
+		return length;
+	}
+
+	bool isOpen() const {
+		return bytes != nullptr;
+	}
+
+	void close() {
+#ifdef _WIN32
+		if (bytes) UnmapViewOfFile(bytes);
+		if (mapping != NULL) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (bytes) munmap((void*)bytes, length);
+		if (fd >= 0) ::close(fd);
+		fd = -1;
+#endif
+		bytes = nullptr;
+		length = 0;
+	}
+
+	~MappedFile() {
+		close();
+	}
+
+private:
+	const unsigned char* bytes = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int fd = -1;
+#endif
+};
+
+// resident set size of this process in bytes, 0 when the platform doesn't report it
+inline size_t residentMemoryBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.WorkingSetSize;
+	return 0;
+#else
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm == NULL) return 0;
+	unsigned long pages = 0, resident = 0;
+	const int read = fscanf(statm, "%lu %lu", &pages, &resident);
+	fclose(statm);
+	return read == 2 ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+#endif
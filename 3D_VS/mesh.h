@@ -0,0 +1,207 @@
+#pragma once
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mesh_format.h"
+#include "occlusion_culling.h"
+
+// GPU-only mesh: a .vsmesh file is mapped, its streams are copied straight from the mapping into immutable
+// buffers and the mapping is released, so no CPU copy of the geometry outlives load() except the positions and
+// full detail indices kept as the occluder shape for the software occlusion culler
+class Mesh {
+public:
+	unsigned int VAO = 0;
+	GLsizei vertexCount = 0;
+	GLsizei indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT;
+	glm::vec3 boundsMin = glm::vec3(0.f), boundsMax = glm::vec3(0.f);
+	// levels of detail, finest first; indexCount is the count of level 0
+	MeshLod lods[MESH_MAX_LODS] = {};
+	unsigned int lodCount = 0;
+	// model-space positions (each stored once, whatever the other attributes), the full detail triangles over
+	// them and their edge adjacency, for OcclusionBuffer::addTriangles; coarser levels are not used, since
+	// simplification can move the surface outside the real silhouette
+	std::vector<glm::vec3> occluderPositions;
+	std::vector<uint32_t> occluderIndices;
+	std::vector<uint32_t> occluderAdjacency;
+
+	// load cost, for the mesh benchmark and startup report
+	struct LoadStats {
+		double milliseconds = 0;
+		size_t fileBytes = 0;
+		size_t gpuBytes = 0;
+		size_t vertexBytes = 0;
+	};
+
+	Mesh() = default;
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	bool load(const std::string& path) {
+		release();
+		const auto begin = std::chrono::steady_clock::now();
+		MappedFile file(path);
+		const MeshFileHeader* header = file.isOpen() ? readMeshHeader(file.data(), file.size()) : nullptr;
+		if (header == nullptr) {
+			std::cout << "ERROR::MESH::INVALID_FILE: " << path << std::endl;
+			return false;
+		}
+
+		vertexCount = (GLsizei)header->vertexCount;
+		lodCount = header->lodCount;
+		for (unsigned int i = 0; i < lodCount; i++) lods[i] = header->lods[i];
+		indexCount = (GLsizei)lods[0].indexCount;
+		indexType = header->indexType;
+		boundsMin = glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+		boundsMax = glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+
+		streamCount = header->streamCount;
+		glCreateBuffers(streamCount, streams);
+		for (unsigned int i = 0; i < streamCount; i++) {
+			const auto& stream = header->streams[i];
+			glNamedBufferStorage(streams[i], (GLsizeiptr)stream.size, file.data() + stream.offset, 0);
+			strides[i] = (GLsizei)stream.stride;
+			stats.gpuBytes += (size_t)stream.size;
+			stats.vertexBytes += (size_t)stream.size;
+		}
+		glCreateBuffers(1, &EBO);
+		glNamedBufferStorage(EBO, (GLsizeiptr)header->indexSize, file.data() + header->indexOffset, 0);
+		stats.gpuBytes += (size_t)header->indexSize;
+
+		attributeCount = header->attributeCount;
+		for (unsigned int i = 0; i < attributeCount; i++) attributes[i] = header->attributes[i];
+		VAO = createVertexArray();
+		readOccluder(*header, file.data());
+
+		stats.fileBytes = file.size();
+		file.close();
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		return true;
+	}
+
+	// a new VAO with this mesh's streams on binding points 0..MESH_MAX_STREAMS-1, for callers that add
+	// their own attributes (e.g. an instance stream) without touching the mesh's own VAO
+	unsigned int createVertexArray() const {
+		unsigned int vao;
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+		for (unsigned int i = 0; i < streamCount; i++) glBindVertexBuffer(i, streams[i], 0, strides[i]);
+		for (unsigned int i = 0; i < attributeCount; i++) {
+			const auto& attribute = attributes[i];
+			glVertexAttribFormat(attribute.location, (GLint)attribute.components, attribute.type, attribute.normalized ? GL_TRUE : GL_FALSE, attribute.offset);
+			glVertexAttribBinding(attribute.location, attribute.stream);
+			glEnableVertexAttribArray(attribute.location);
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBindVertexArray(0);
+		return vao;
+	}
+
+	// byte offset of a level's first index in the element buffer, for the draw calls
+	const void* lodIndices(unsigned int lod) const {
+		return (const void*)((size_t)lods[lod].indexOffset * (indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t)));
+	}
+
+	void draw(unsigned int lod = 0) const {
+		glBindVertexArray(VAO);
+		glDrawElements(GL_TRIANGLES, (GLsizei)lods[lod].indexCount, indexType, lodIndices(lod));
+	}
+
+	const LoadStats& loadStats() const {
+		return stats;
+	}
+
+	void release() {
+		if (VAO) glDeleteVertexArrays(1, &VAO);
+		if (streamCount) glDeleteBuffers(streamCount, streams);
+		if (EBO) glDeleteBuffers(1, &EBO);
+		VAO = EBO = 0;
+		streamCount = attributeCount = lodCount = 0;
+		occluderPositions.clear();
+		occluderIndices.clear();
+		occluderAdjacency.clear();
+		stats = LoadStats();
+	}
+
+	~Mesh() {
+		release();
+	}
+
+private:
+	unsigned int EBO = 0;
+	unsigned int streams[MESH_MAX_STREAMS] = {};
+	GLsizei strides[MESH_MAX_STREAMS] = {};
+	unsigned int streamCount = 0;
+	MeshFileAttribute attributes[MESH_MAX_ATTRIBUTES] = {};
+	unsigned int attributeCount = 0;
+	LoadStats stats;
+
+	// decodes every position and the full detail indices from the mapping, positions are stored as float or half;
+	// vertices split only by color or normal are welded, so the triangles around them become neighbors
+	void readOccluder(const MeshFileHeader& header, const unsigned char* data) {
+		const MeshFileAttribute* position = nullptr;
+		for (unsigned int i = 0; i < attributeCount; i++) {
+			if (attributes[i].location == VERTEX_POSITION) position = &attributes[i];
+		}
+		if (position == nullptr || (position->type != GL_FLOAT && position->type != GL_HALF_FLOAT)) return;
+		const MeshFileStream& stream = header.streams[position->stream];
+		if (position->offset + (position->type == GL_FLOAT ? sizeof(glm::vec3) : 3 * sizeof(uint16_t)) > stream.stride) return;
+		occluderPositions.resize(header.vertexCount);
+		for (uint32_t i = 0; i < header.vertexCount; i++) {
+			const unsigned char* vertex = data + stream.offset + (size_t)i * stream.stride + position->offset;
+			if (position->type == GL_FLOAT) std::memcpy(&occluderPositions[i], vertex, sizeof(glm::vec3));
+			else {
+				uint16_t half[3];
+				std::memcpy(half, vertex, sizeof(half));
+				occluderPositions[i] = glm::vec3(glm::unpackHalf1x16(half[0]), glm::unpackHalf1x16(half[1]), glm::unpackHalf1x16(half[2]));
+			}
+		}
+		const unsigned char* indices = data + header.indexOffset;
+		occluderIndices.resize(lods[0].indexCount);
+		for (uint32_t i = 0; i < lods[0].indexCount; i++) {
+			const uint32_t slot = lods[0].indexOffset + i;
+			if (indexType == GL_UNSIGNED_SHORT) {
+				uint16_t value;
+				std::memcpy(&value, indices + slot * sizeof(uint16_t), sizeof(value));
+				occluderIndices[i] = value;
+			}
+			else std::memcpy(&occluderIndices[i], indices + (size_t)slot * sizeof(uint32_t), sizeof(uint32_t));
+			if (occluderIndices[i] >= header.vertexCount) {
+				occluderPositions.clear();
+				occluderIndices.clear();
+				return;
+			}
+		}
+
+		std::vector<uint32_t> order(occluderPositions.size());
+		for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+		const auto less = [this](uint32_t a, uint32_t b) {
+			const glm::vec3& p = occluderPositions[a];
+			const glm::vec3& q = occluderPositions[b];
+			return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z < q.z;
+		};
+		std::sort(order.begin(), order.end(), less);
+		std::vector<uint32_t> remap(order.size());
+		std::vector<glm::vec3> welded;
+		for (size_t i = 0; i < order.size(); i++) {
+			if (i == 0 || less(order[i - 1], order[i])) welded.push_back(occluderPositions[order[i]]);
+			remap[order[i]] = (uint32_t)welded.size() - 1;
+		}
+		occluderPositions.swap(welded);
+		for (uint32_t& index : occluderIndices) index = remap[index];
+		OcclusionBuffer::buildAdjacency(occluderIndices.data(), occluderIndices.size(), occluderAdjacency);
+	}
+};
+
+#endif
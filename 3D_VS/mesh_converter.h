@@ -0,0 +1,56 @@
+#pragma once
+#ifndef MESH_CONVERTER_H
+#define MESH_CONVERTER_H
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "mapped_file.h"
+#include "mesh_format.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "obj_importer.h"
+
+// offline conversion step, also used by --convert-mesh; the full detail level is optimized first and the
+// coarser levels are simplified from it, sharing its vertices
+inline bool convertObjToMesh(const std::string& objPath, const std::string& meshPath, const VertexLayout& layout = VertexLayout::packed()) {
+	const auto begin = std::chrono::steady_clock::now();
+	MeshData mesh;
+	ObjImporter importer;
+	if (!importer.import(objPath, mesh)) {
+		std::cout << "ERROR::MESH_CONVERTER::FAILED_TO_READ: " << objPath << std::endl;
+		return false;
+	}
+	const MeshOptimizeStats optimized = optimizeMesh(mesh);
+	const size_t fullDetailIndices = mesh.indices.size();
+	const MeshLodStats lods = generateLods(mesh);
+	if (!writeMeshFile(meshPath, mesh, layout)) {
+		std::cout << "ERROR::MESH_CONVERTER::FAILED_TO_WRITE: " << meshPath << std::endl;
+		return false;
+	}
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	std::cout << "Converted " << objPath << " -> " << meshPath << ": " << mesh.vertices.size() << " vertices, "
+		<< fullDetailIndices / 3 << " triangles in " << ms << " ms (import " << importer.statistics().milliseconds
+		<< " ms on " << importer.statistics().threads << " threads, optimize " << optimized.milliseconds << " ms, ACMR "
+		<< optimized.acmrBefore << " -> " << optimized.acmrAfter << ", " << lods.levels << " LODs in " << lods.milliseconds << " ms)" << std::endl;
+	for (size_t i = 1; i < mesh.lods.size(); i++) std::cout << "  LOD " << i << ": " << mesh.lods[i].indexCount / 3 << " triangles, error " << mesh.lods[i].error << std::endl;
+	return true;
+}
+
+// reconverts the source when the binary mesh is missing, older or written by an older format version, so
+// edited assets are picked up on launch
+inline bool ensureMeshFile(const std::string& objPath, const std::string& meshPath) {
+	std::error_code sourceError, meshError;
+	const auto sourceTime = std::filesystem::last_write_time(objPath, sourceError);
+	const auto meshTime = std::filesystem::last_write_time(meshPath, meshError);
+	if (!meshError && (sourceError || meshTime >= sourceTime)) {
+		MappedFile file(meshPath);
+		if (file.isOpen() && readMeshHeader(file.data(), file.size()) != nullptr) return true;
+		if (sourceError) return false;
+	}
+	return convertObjToMesh(objPath, meshPath);
+}
+
+#endif
@@ -0,0 +1,213 @@
+#pragma once
+#ifndef MESH_FORMAT_H
+#define MESH_FORMAT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "vertex_layout.h"
+
+// .vsmesh: a fixed header followed by raw vertex streams and one index stream, every block 16-byte aligned,
+// so a mapped file can be handed to the GL as is; the index stream holds every level of detail back to back
+const uint32_t MESH_FILE_MAGIC = 0x314D5356; // "VSM1"
+const uint32_t MESH_FILE_VERSION = 2;
+const uint32_t MESH_MAX_STREAMS = 4;
+const uint32_t MESH_MAX_ATTRIBUTES = 8;
+const uint32_t MESH_MAX_LODS = 8;
+
+// one vertex buffer in the file
+struct MeshFileStream {
+	uint64_t offset;
+	uint64_t size;
+	uint32_t stride;
+	uint32_t reserved;
+};
+
+// one shader input, read from a stream with the given GL format
+struct MeshFileAttribute {
+	uint32_t location;
+	uint32_t stream;
+	uint32_t components;
+	uint32_t type;
+	uint32_t normalized;
+	uint32_t offset;
+};
+
+// one level of detail: a range of the index stream over the shared vertices, and the geometric error of the
+// simplification in model units (0 for the full detail level)
+struct MeshLod {
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error;
+	uint32_t reserved;
+};
+
+struct MeshFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexType;
+	uint32_t streamCount;
+	uint32_t attributeCount;
+	uint32_t reserved;
+	uint64_t indexOffset;
+	uint64_t indexSize;
+	float boundsMin[3];
+	float boundsMax[3];
+	MeshFileStream streams[MESH_MAX_STREAMS];
+	MeshFileAttribute attributes[MESH_MAX_ATTRIBUTES];
+	uint32_t lodCount;
+	uint32_t reserved2[3];
+	MeshLod lods[MESH_MAX_LODS];
+};
+
+// full precision vertex produced by the importers, packed into a VertexLayout when it is written out
+struct MeshVertex {
+	glm::vec3 position;
+	glm::vec3 color;
+	glm::vec3 normal;
+};
+
+// CPU side geometry, only used by tools and importers before it is written out; without lods the indices
+// are a single full detail level
+struct MeshData {
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<MeshLod> lods;
+	bool hasNormals = false;
+};
+
+// checks that a mapped file holds a complete mesh, returns its header or nullptr
+inline const MeshFileHeader* readMeshHeader(const unsigned char* data, size_t size) {
+	if (data == nullptr || size < sizeof(MeshFileHeader)) return nullptr;
+	const auto header = (const MeshFileHeader*)data;
+	if (header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION) return nullptr;
+	if (header->streamCount > MESH_MAX_STREAMS || header->attributeCount > MESH_MAX_ATTRIBUTES) return nullptr;
+	if (header->indexType != GL_UNSIGNED_INT && header->indexType != GL_UNSIGNED_SHORT) return nullptr;
+	// every block must hold exactly what the counts describe, or draws would read past the GL buffers
+	const uint64_t indexBytes = header->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	if (header->indexSize != (uint64_t)header->indexCount * indexBytes) return nullptr;
+	if (header->indexOffset > size || header->indexSize > size - header->indexOffset) return nullptr;
+	for (uint32_t i = 0; i < header->streamCount; i++) {
+		const MeshFileStream& stream = header->streams[i];
+		if (stream.stride == 0 || stream.size != (uint64_t)header->vertexCount * stream.stride) return nullptr;
+		if (stream.offset > size || stream.size > size - stream.offset) return nullptr;
+	}
+	for (uint32_t i = 0; i < header->attributeCount; i++) {
+		if (header->attributes[i].stream >= header->streamCount) return nullptr;
+		if (header->attributes[i].offset >= header->streams[header->attributes[i].stream].stride) return nullptr;
+	}
+	if (header->lodCount == 0 || header->lodCount > MESH_MAX_LODS) return nullptr;
+	for (uint32_t i = 0; i < header->lodCount; i++) {
+		if ((uint64_t)header->lods[i].indexOffset + header->lods[i].indexCount > header->indexCount) return nullptr;
+	}
+	return header;
+}
+
+// packs the vertices into the streams of the given layout (normals are dropped when the mesh has none) and
+// writes them with 16-bit indices when every vertex fits, 32-bit otherwise
+inline bool writeMeshFile(const std::string& path, const MeshData& mesh, const VertexLayout& requestedLayout = VertexLayout::packed()) {
+	if (mesh.vertices.empty() || mesh.indices.empty() || mesh.lods.size() > MESH_MAX_LODS) return false;
+	const VertexLayout layout = mesh.hasNormals ? requestedLayout : requestedLayout.without(VERTEX_NORMAL);
+	const uint32_t streamCount = layout.streamCount();
+	if (streamCount == 0 || streamCount > MESH_MAX_STREAMS || layout.attributes().size() > MESH_MAX_ATTRIBUTES) return false;
+
+	MeshFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.vertexCount = (uint32_t)mesh.vertices.size();
+	header.indexCount = (uint32_t)mesh.indices.size();
+	const bool shortIndices = mesh.vertices.size() <= 0x10000;
+	header.indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+	glm::vec3 boundsMin = mesh.vertices[0].position, boundsMax = mesh.vertices[0].position;
+	for (const auto& vertex : mesh.vertices) {
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+	for (int i = 0; i < 3; i++) {
+		header.boundsMin[i] = boundsMin[i];
+		header.boundsMax[i] = boundsMax[i];
+	}
+
+	// encode every stream up front, the file is then written block by block
+	std::vector<std::vector<unsigned char>> streams(streamCount);
+	for (uint32_t stream = 0; stream < streamCount; stream++) streams[stream].resize((size_t)layout.stride(stream) * mesh.vertices.size());
+	for (const auto& element : layout.attributes()) {
+		const uint32_t stride = layout.stride(element.stream);
+		unsigned char* destination = streams[element.stream].data() + element.offset;
+		for (const auto& vertex : mesh.vertices) {
+			const glm::vec3& value = element.attribute == VERTEX_POSITION ? vertex.position : element.attribute == VERTEX_COLOR ? vertex.color : vertex.normal;
+			packVertexAttribute(element.format, value, destination);
+			destination += stride;
+		}
+	}
+
+	const auto align = [](uint64_t offset) { return (offset + 15) / 16 * 16; };
+	std::vector<const void*> blocks;
+	std::vector<uint64_t> sizes;
+	for (const auto& stream : streams) {
+		blocks.push_back(stream.data());
+		sizes.push_back(stream.size());
+	}
+	std::vector<uint16_t> shorts;
+	if (shortIndices) {
+		shorts.assign(mesh.indices.begin(), mesh.indices.end());
+		blocks.push_back(shorts.data());
+		sizes.push_back(shorts.size() * sizeof(uint16_t));
+	}
+	else {
+		blocks.push_back(mesh.indices.data());
+		sizes.push_back(mesh.indices.size() * sizeof(uint32_t));
+	}
+	std::vector<uint64_t> offsets(blocks.size());
+	uint64_t end = align(sizeof(MeshFileHeader));
+	for (size_t i = 0; i < blocks.size(); i++) {
+		offsets[i] = end;
+		end = align(end + sizes[i]);
+	}
+
+	header.streamCount = streamCount;
+	for (uint32_t i = 0; i < streamCount; i++) header.streams[i] = { offsets[i], sizes[i], layout.stride(i), 0 };
+	header.attributeCount = (uint32_t)layout.attributes().size();
+	for (uint32_t i = 0; i < header.attributeCount; i++) {
+		const auto& element = layout.attributes()[i];
+		GLint components;
+		GLenum type;
+		GLboolean normalized;
+		vertexFormatGL(element.format, components, type, normalized);
+		header.attributes[i] = { (uint32_t)element.attribute, element.stream, (uint32_t)components, type, normalized, element.offset };
+	}
+	header.indexOffset = offsets[streamCount];
+	header.indexSize = sizes[streamCount];
+	if (mesh.lods.empty()) {
+		header.lodCount = 1;
+		header.lods[0] = { 0, header.indexCount, 0.f, 0 };
+	}
+	else {
+		header.lodCount = (uint32_t)mesh.lods.size();
+		for (uint32_t i = 0; i < header.lodCount; i++) header.lods[i] = mesh.lods[i];
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) return false;
+	static const char padding[16] = {};
+	file.write((const char*)&header, sizeof(header));
+	file.write(padding, offsets[0] - sizeof(header));
+	for (size_t i = 0; i < blocks.size(); i++) {
+		file.write((const char*)blocks[i], sizes[i]);
+		const uint64_t next = i + 1 < blocks.size() ? offsets[i + 1] : end;
+		file.write(padding, next - offsets[i] - sizes[i]);
+	}
+	return (bool)file;
+}
+
+#endif
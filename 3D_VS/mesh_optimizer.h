@@ -0,0 +1,220 @@
+#pragma once
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "mesh_format.h"
+
+// offline index and vertex reordering run by the mesh converter; nothing here touches GL
+
+// average cache miss ratio: transformed vertices per triangle with a FIFO post-transform cache, 0.5 is the
+// best a regular grid can reach and 3 means no reuse at all
+inline double computeAcmr(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize = 16) {
+	if (indices.size() < 3) return 0;
+	std::vector<size_t> cachedAt(vertexCount, 0);
+	size_t clock = 0, misses = 0;
+	for (uint32_t index : indices) {
+		// a vertex is still cached when fewer than cacheSize misses happened since it was last loaded
+		if (cachedAt[index] == 0 || clock - cachedAt[index] >= cacheSize) {
+			cachedAt[index] = ++clock;
+			misses++;
+		}
+	}
+	return (double)misses / (indices.size() / 3);
+}
+
+// Forsyth's linear-speed vertex cache optimisation: triangles are emitted greedily by a score that favours
+// vertices in a simulated LRU cache and vertices with few triangles left
+inline void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+	const int CACHE_SIZE = 32;
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) return;
+
+	auto vertexScore = [](int cachePosition, unsigned int remaining) {
+		if (remaining == 0) return -1.f;
+		float score = 0.f;
+		if (cachePosition >= 3) score = std::pow(1.f - (cachePosition - 3) / (float)(CACHE_SIZE - 3), 1.5f);
+		else if (cachePosition >= 0) score = 0.75f; // the last triangle's vertices, deliberately below the best
+		return score + 2.f / std::sqrt((float)remaining);
+	};
+
+	// triangles of every vertex, as offsets into one array
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (uint32_t index : indices) remaining[index]++;
+	std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; i++) adjacencyStart[i + 1] = adjacencyStart[i] + remaining[i];
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> score(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) score[i] = vertexScore(-1, remaining[i]);
+	std::vector<float> triangleScore(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++) triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+	std::vector<bool> emitted(triangleCount, false);
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	std::vector<uint32_t> cache, nextCache;
+	size_t best = 0, scanCursor = 0;
+	for (size_t t = 1; t < triangleCount; t++) {
+		if (triangleScore[t] > triangleScore[best]) best = t;
+	}
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+		const uint32_t* triangle = &indices[best * 3];
+		result.insert(result.end(), triangle, triangle + 3);
+		emitted[best] = true;
+
+		// the triangle's vertices move to the front of the cache, everything else shifts back
+		nextCache.assign(triangle, triangle + 3);
+		for (uint32_t vertex : cache) {
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) nextCache.push_back(vertex);
+		}
+		for (int corner = 0; corner < 3; corner++) {
+			const uint32_t vertex = triangle[corner];
+			remaining[vertex]--;
+			// move the emitted triangle to the end of the vertex's live range
+			const size_t begin = adjacencyStart[vertex], end = begin + remaining[vertex] + 1;
+			for (size_t i = begin; i < end; i++) {
+				if (adjacency[i] == best) {
+					std::swap(adjacency[i], adjacency[end - 1]);
+					break;
+				}
+			}
+		}
+
+		// rescore every vertex whose cache position changed, including the ones that fell out
+		for (size_t i = 0; i < nextCache.size(); i++) {
+			const uint32_t vertex = nextCache[i];
+			cachePosition[vertex] = i < (size_t)CACHE_SIZE ? (int)i : -1;
+			score[vertex] = vertexScore(cachePosition[vertex], remaining[vertex]);
+		}
+		if (nextCache.size() > (size_t)CACHE_SIZE) nextCache.resize(CACHE_SIZE);
+		cache.swap(nextCache);
+
+		// the next triangle is the best one touching the cache, or the first live one when the cache has none
+		float bestScore = -1.f;
+		best = triangleCount;
+		for (uint32_t vertex : cache) {
+			const size_t begin = adjacencyStart[vertex];
+			for (size_t i = begin; i < begin + remaining[vertex]; i++) {
+				const uint32_t t = adjacency[i];
+				triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+		if (best == triangleCount) {
+			while (scanCursor < triangleCount && emitted[scanCursor]) scanCursor++;
+			best = scanCursor;
+		}
+	}
+	indices.swap(result);
+}
+
+// Sander et al. style overdraw pass: the cache-ordered triangles are cut into clusters where the cache would
+// start cold anyway and the clusters are sorted so the outward facing ones draw first, letting early depth
+// testing reject more of what lies behind them without giving up vertex reuse
+inline void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshVertex>& vertices, unsigned int cacheSize = 16) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2) return;
+
+	std::vector<size_t> clusterStarts;
+	std::vector<size_t> cachedAt(vertices.size(), 0);
+	size_t clock = 0;
+	for (size_t t = 0; t < triangleCount; t++) {
+		int misses = 0;
+		for (int corner = 0; corner < 3; corner++) {
+			const uint32_t index = indices[t * 3 + corner];
+			if (cachedAt[index] == 0 || clock - cachedAt[index] >= cacheSize) {
+				cachedAt[index] = ++clock;
+				misses++;
+			}
+		}
+		if (t == 0 || misses == 3) clusterStarts.push_back(t);
+	}
+	clusterStarts.push_back(triangleCount);
+
+	glm::vec3 meshCenter(0.f);
+	for (const auto& vertex : vertices) meshCenter += vertex.position;
+	meshCenter /= (float)vertices.size();
+
+	struct Cluster {
+		size_t begin, end;
+		float key;
+	};
+	std::vector<Cluster> clusters;
+	for (size_t c = 0; c + 1 < clusterStarts.size(); c++) {
+		glm::vec3 center(0.f), normal(0.f);
+		float area = 0.f;
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+			const glm::vec3& a = vertices[indices[t * 3]].position;
+			const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+			const glm::vec3& d = vertices[indices[t * 3 + 2]].position;
+			const glm::vec3 cross = glm::cross(b - a, d - a);
+			const float triangleArea = glm::length(cross);
+			center += (a + b + d) * (triangleArea / 3.f);
+			normal += cross;
+			area += triangleArea;
+		}
+		const float normalLength = glm::length(normal);
+		float key = 0.f;
+		if (area > 0.f && normalLength > 0.f) key = glm::dot(center / area - meshCenter, normal / normalLength);
+		clusters.push_back({ clusterStarts[c], clusterStarts[c + 1], key });
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.key > b.key; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (const auto& cluster : clusters) result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+	indices.swap(result);
+}
+
+// renumbers vertices in the order the indices first use them so vertex fetch walks memory forwards;
+// unreferenced vertices are dropped
+inline void optimizeVertexFetch(MeshData& mesh) {
+	const uint32_t UNUSED = 0xFFFFFFFFu;
+	std::vector<uint32_t> remap(mesh.vertices.size(), UNUSED);
+	std::vector<MeshVertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+	for (uint32_t& index : mesh.indices) {
+		if (remap[index] == UNUSED) {
+			remap[index] = (uint32_t)vertices.size();
+			vertices.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+	mesh.vertices.swap(vertices);
+}
+
+struct MeshOptimizeStats {
+	double acmrBefore = 0;
+	double acmrAfter = 0;
+	double milliseconds = 0;
+};
+
+// triangle order for the vertex cache, then cluster order for overdraw, then vertex order for fetch locality
+inline MeshOptimizeStats optimizeMesh(MeshData& mesh) {
+	const auto begin = std::chrono::steady_clock::now();
+	MeshOptimizeStats stats;
+	stats.acmrBefore = computeAcmr(mesh.indices, mesh.vertices.size());
+	optimizeVertexCache(mesh.indices, mesh.vertices.size());
+	optimizeOverdraw(mesh.indices, mesh.vertices);
+	optimizeVertexFetch(mesh);
+	stats.acmrAfter = computeAcmr(mesh.indices, mesh.vertices.size());
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	return stats;
+}
+
+#endif
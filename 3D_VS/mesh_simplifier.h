@@ -0,0 +1,274 @@
+#pragma once
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "mesh_format.h"
+#include "mesh_optimizer.h"
+
+// offline quadric error metric simplification (Garland/Heckbert) used to build the level of detail chain;
+// every collapse moves a vertex onto one of its neighbours, so all levels share the original vertex buffer
+// and only differ in their indices
+
+// sum of squared distances to a set of planes, weighted by triangle area; error() is the weighted mean
+struct Quadric {
+	double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+	double weight = 0;
+
+	void addPlane(const glm::vec3& normal, float distance, float planeWeight) {
+		const double a = normal.x, b = normal.y, c = normal.z, d = distance, w = planeWeight;
+		a2 += w * a * a;
+		ab += w * a * b;
+		ac += w * a * c;
+		ad += w * a * d;
+		b2 += w * b * b;
+		bc += w * b * c;
+		bd += w * b * d;
+		c2 += w * c * c;
+		cd += w * c * d;
+		d2 += w * d * d;
+		weight += w;
+	}
+
+	Quadric& operator+=(const Quadric& other) {
+		a2 += other.a2;
+		ab += other.ab;
+		ac += other.ac;
+		ad += other.ad;
+		b2 += other.b2;
+		bc += other.bc;
+		bd += other.bd;
+		c2 += other.c2;
+		cd += other.cd;
+		d2 += other.d2;
+		weight += other.weight;
+		return *this;
+	}
+
+	// mean squared distance of a point to the planes
+	double error(const glm::vec3& p) const {
+		if (weight <= 0) return 0;
+		const double x = p.x, y = p.y, z = p.z;
+		const double sum = a2 * x * x + b2 * y * y + c2 * z * z + 2 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z) + d2;
+		return std::max(0.0, sum / weight);
+	}
+};
+
+// reduces the triangles in indices towards targetIndexCount without moving any surface further than maxError
+// (model units); returns the new indices over the same vertices and writes the error actually reached.
+// Vertices on attribute seams (same position, different color or normal) stay in place, and border vertices
+// only slide along the border, so levels keep their silhouette and never tear
+inline std::vector<uint32_t> simplifyMesh(const MeshData& mesh, const std::vector<uint32_t>& source, size_t targetIndexCount, float maxError, float* resultError = nullptr) {
+	enum VertexKind : uint8_t { MANIFOLD, BORDER, LOCKED };
+	const float BORDER_WEIGHT = 10.f;
+	const size_t vertexCount = mesh.vertices.size();
+	std::vector<uint32_t> indices = source;
+	if (resultError) *resultError = 0.f;
+	if (indices.size() <= targetIndexCount || vertexCount == 0) return indices;
+
+	// vertices sharing a position are welded for the topology tests and locked
+	struct PositionHash {
+		size_t operator()(const glm::vec3& p) const {
+			uint32_t bits[3];
+			std::memcpy(bits, &p, sizeof(bits));
+			return (size_t)bits[0] * 73856093u ^ (size_t)bits[1] * 19349663u ^ (size_t)bits[2] * 83492791u;
+		}
+	};
+	std::unordered_map<glm::vec3, uint32_t, PositionHash> firstAtPosition;
+	std::vector<uint32_t> welded(vertexCount);
+	std::vector<uint8_t> kind(vertexCount, MANIFOLD);
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		const auto inserted = firstAtPosition.emplace(mesh.vertices[v].position, v);
+		welded[v] = inserted.first->second;
+		if (!inserted.second) kind[v] = kind[welded[v]] = LOCKED;
+	}
+	for (uint32_t v = 0; v < vertexCount; v++) kind[v] = kind[welded[v]];
+
+	// an edge without its opposite half-edge is a border; vertices on more or fewer than two border edges
+	// (bow ties, lone corners) are locked too
+	const auto edgeKey = [&](uint32_t a, uint32_t b) { return (uint64_t)welded[a] << 32 | welded[b]; };
+	std::unordered_set<uint64_t> halfEdges;
+	const auto findHalfEdges = [&]() {
+		halfEdges.clear();
+		halfEdges.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			for (int e = 0; e < 3; e++) halfEdges.insert(edgeKey(indices[i + e], indices[i + (e + 1) % 3]));
+		}
+	};
+	findHalfEdges();
+	const auto isBorder = [&](uint32_t a, uint32_t b) { return halfEdges.count(edgeKey(b, a)) == 0; };
+	std::vector<uint8_t> borderEdges(vertexCount, 0);
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		for (int e = 0; e < 3; e++) {
+			const uint32_t a = indices[i + e], b = indices[i + (e + 1) % 3];
+			if (!isBorder(a, b)) continue;
+			borderEdges[a] = (uint8_t)std::min(borderEdges[a] + 1, 3);
+			borderEdges[b] = (uint8_t)std::min(borderEdges[b] + 1, 3);
+		}
+	}
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		if (kind[v] == MANIFOLD && borderEdges[v] > 0) kind[v] = borderEdges[v] == 2 ? BORDER : LOCKED;
+	}
+
+	// triangle planes, plus a plane standing on every border edge that keeps the border in place
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		const glm::vec3& a = mesh.vertices[indices[i]].position;
+		const glm::vec3& b = mesh.vertices[indices[i + 1]].position;
+		const glm::vec3& c = mesh.vertices[indices[i + 2]].position;
+		const glm::vec3 cross = glm::cross(b - a, c - a);
+		const float length = glm::length(cross);
+		if (length == 0.f) continue;
+		const glm::vec3 normal = cross / length;
+		for (int corner = 0; corner < 3; corner++) quadrics[indices[i + corner]].addPlane(normal, -glm::dot(normal, a), length * 0.5f);
+		for (int e = 0; e < 3; e++) {
+			const uint32_t from = indices[i + e], to = indices[i + (e + 1) % 3];
+			if (!isBorder(from, to)) continue;
+			const glm::vec3 edge = mesh.vertices[to].position - mesh.vertices[from].position;
+			const float edgeLength = glm::length(edge);
+			if (edgeLength == 0.f) continue;
+			const glm::vec3 side = glm::normalize(glm::cross(edge, normal));
+			const float distance = -glm::dot(side, mesh.vertices[from].position);
+			quadrics[from].addPlane(side, distance, edgeLength * edgeLength * BORDER_WEIGHT);
+			quadrics[to].addPlane(side, distance, edgeLength * edgeLength * BORDER_WEIGHT);
+		}
+	}
+
+	struct Collapse {
+		uint32_t from, to;
+		float cost;
+	};
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> collapseTo(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<size_t> adjacencyStart(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	const double maxCost = (double)maxError * maxError;
+	double reachedCost = 0;
+
+	// each pass collapses the cheapest edges whose neighbourhoods do not overlap, then compacts the indices
+	for (bool firstPass = true; indices.size() > targetIndexCount; firstPass = false) {
+		const size_t triangleCount = indices.size() / 3;
+		// collapses create new edges, the border test has to see them
+		if (!firstPass) findHalfEdges();
+		std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+		for (uint32_t index : indices) adjacencyStart[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++) adjacencyStart[v + 1] += adjacencyStart[v];
+		adjacency.resize(indices.size());
+		std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			for (int e = 0; e < 3; e++) {
+				const uint32_t a = indices[i + e], b = indices[i + (e + 1) % 3];
+				for (int direction = 0; direction < 2; direction++) {
+					const uint32_t from = direction ? b : a, to = direction ? a : b;
+					if (kind[from] == LOCKED || (kind[from] == BORDER && (kind[to] == MANIFOLD || !isBorder(a, b)))) continue;
+					Quadric combined = quadrics[from];
+					combined += quadrics[to];
+					const double cost = combined.error(mesh.vertices[to].position);
+					if (cost <= maxCost) collapses.push_back({ from, to, (float)cost });
+				}
+			}
+		}
+		if (collapses.empty()) break;
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+		for (size_t v = 0; v < vertexCount; v++) collapseTo[v] = (uint32_t)v;
+		std::fill(touched.begin(), touched.end(), false);
+		const size_t goal = (indices.size() - targetIndexCount) / 3;
+		size_t removed = 0;
+		for (const Collapse& collapse : collapses) {
+			if (removed >= goal) break;
+			if (touched[collapse.from] || touched[collapse.to]) continue;
+
+			// reject collapses that flip a triangle around the moving vertex, count the ones that vanish
+			const glm::vec3& target = mesh.vertices[collapse.to].position;
+			bool flips = false;
+			size_t vanishing = 0;
+			for (size_t a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1] && !flips; a++) {
+				const uint32_t* triangle = &indices[(size_t)adjacency[a] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+					vanishing++;
+					continue;
+				}
+				glm::vec3 corners[3], moved[3];
+				for (int corner = 0; corner < 3; corner++) {
+					corners[corner] = mesh.vertices[triangle[corner]].position;
+					moved[corner] = triangle[corner] == collapse.from ? target : corners[corner];
+				}
+				const glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+				const glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+				// nearly perpendicular counts as flipped too, that is where slivers fold over
+				flips = glm::dot(before, after) <= 1e-2f * glm::length(before) * glm::length(after);
+			}
+			if (flips) continue;
+
+			// the whole neighbourhood is frozen for the rest of the pass, so later flip tests see final positions
+			for (size_t a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1]; a++) {
+				const uint32_t* triangle = &indices[(size_t)adjacency[a] * 3];
+				touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+			}
+			collapseTo[collapse.from] = collapse.to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			reachedCost = std::max(reachedCost, (double)collapse.cost);
+			removed += vanishing;
+		}
+		if (removed == 0) break;
+
+		size_t kept = 0;
+		for (size_t t = 0; t < triangleCount; t++) {
+			const uint32_t a = collapseTo[indices[t * 3]], b = collapseTo[indices[t * 3 + 1]], c = collapseTo[indices[t * 3 + 2]];
+			if (a == b || b == c || a == c) continue;
+			indices[kept++] = a;
+			indices[kept++] = b;
+			indices[kept++] = c;
+		}
+		indices.resize(kept);
+	}
+	if (resultError) *resultError = (float)std::sqrt(reachedCost);
+	return indices;
+}
+
+struct MeshLodStats {
+	double milliseconds = 0;
+	size_t levels = 0;
+};
+
+// appends coarser levels to mesh.indices, each aiming at half the triangles of the one before, until a level
+// no longer shrinks by a useful amount; errors add up along the chain so each one bounds the distance to
+// the full detail surface. Every level is reordered for the vertex cache
+inline MeshLodStats generateLods(MeshData& mesh) {
+	const auto begin = std::chrono::steady_clock::now();
+	const size_t MIN_LOD_TRIANGLES = 16;
+	mesh.lods.assign(1, { 0, (uint32_t)mesh.indices.size(), 0.f, 0 });
+	std::vector<uint32_t> previous = mesh.indices;
+	float error = 0.f;
+	while (mesh.lods.size() < MESH_MAX_LODS && previous.size() / 3 > MIN_LOD_TRIANGLES * 2) {
+		float levelError = 0.f;
+		std::vector<uint32_t> level = simplifyMesh(mesh, previous, previous.size() / 6 * 3, 1e30f, &levelError);
+		if (level.size() > previous.size() * 3 / 4) break;
+		optimizeVertexCache(level, mesh.vertices.size());
+		error += levelError;
+		mesh.lods.push_back({ (uint32_t)mesh.indices.size(), (uint32_t)level.size(), error, 0 });
+		mesh.indices.insert(mesh.indices.end(), level.begin(), level.end());
+		previous.swap(level);
+	}
+	MeshLodStats stats;
+	stats.levels = mesh.lods.size();
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	return stats;
+}
+
+#endif
@@ -0,0 +1,327 @@
+#pragma once
+#ifndef OBJ_IMPORTER_H
+#define OBJ_IMPORTER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mesh_format.h"
+
+// parallel OBJ reader: the mapped file is cut into line-aligned chunks that worker threads parse on their own,
+// chunk results are stitched together with prefix offsets and face corners are deduplicated on their
+// (position, normal) pair into interleaved MeshVertex data. No GL calls are made here, the upload is a separate
+// step (writeMeshFile + Mesh::load) on the GL thread
+class ObjImporter {
+public:
+	struct Stats {
+		double milliseconds = 0;
+		size_t fileBytes = 0;
+		size_t triangles = 0;
+		size_t vertices = 0;
+		unsigned int threads = 0;
+	};
+
+	// 0 threads uses every hardware thread
+	explicit ObjImporter(unsigned int threads = 0) {
+		threadCount = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// reads positions, optional "v x y z r g b" vertex colors, normals and polygon faces (fan triangulated)
+	bool import(const std::string& path, MeshData& mesh) {
+		const auto begin = std::chrono::steady_clock::now();
+		stats = Stats();
+		mesh = MeshData();
+		MappedFile file(path);
+		if (!file.isOpen()) return false;
+		split((const char*)file.data(), file.size());
+
+		forEachChunk([](Chunk& chunk) { parse(chunk); });
+
+		// prefix offsets turn chunk-local counts into file-wide indices
+		size_t positionCount = 0, normalCount = 0, cornerCount = 0;
+		for (auto& chunk : chunks) {
+			chunk.positionOffset = positionCount;
+			chunk.normalOffset = normalCount;
+			chunk.cornerOffset = cornerCount;
+			positionCount += chunk.positions.size();
+			normalCount += chunk.normals.size();
+			cornerCount += chunk.corners.size();
+		}
+		positions.resize(positionCount);
+		colors.resize(positionCount);
+		normals.resize(normalCount);
+		forEachChunk([this](Chunk& chunk) {
+			std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionOffset);
+			std::copy(chunk.colors.begin(), chunk.colors.end(), colors.begin() + chunk.positionOffset);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalOffset);
+			resolve(chunk, positions.size(), normals.size());
+		});
+
+		for (const auto& chunk : chunks) {
+			if (!chunk.valid) {
+				std::cout << "ERROR::OBJ_IMPORTER::INDEX_OUT_OF_RANGE: " << path << std::endl;
+				clear();
+				return false;
+			}
+		}
+
+		// chunks only deduplicate against themselves, the merge maps their unique keys onto global vertices
+		std::unordered_map<uint64_t, uint32_t> vertexOf;
+		vertexOf.reserve(positionCount);
+		mesh.hasNormals = normalCount > 0;
+		for (auto& chunk : chunks) {
+			chunk.remap.resize(chunk.keys.size());
+			for (size_t i = 0; i < chunk.keys.size(); i++) {
+				const uint64_t key = chunk.keys[i];
+				const auto inserted = vertexOf.emplace(key, (uint32_t)mesh.vertices.size());
+				if (inserted.second) {
+					const uint32_t position = (uint32_t)(key >> 32), normal = (uint32_t)key;
+					MeshVertex vertex;
+					vertex.position = positions[position];
+					vertex.color = colors[position];
+					vertex.normal = normal ? normals[normal - 1] : glm::vec3(0.f);
+					mesh.vertices.push_back(vertex);
+				}
+				chunk.remap[i] = inserted.first->second;
+			}
+		}
+
+		mesh.indices.resize(cornerCount);
+		forEachChunk([&mesh](Chunk& chunk) {
+			for (size_t i = 0; i < chunk.indices.size(); i++) mesh.indices[chunk.cornerOffset + i] = chunk.remap[chunk.indices[i]];
+		});
+
+		stats.fileBytes = file.size();
+		stats.triangles = mesh.indices.size() / 3;
+		stats.vertices = mesh.vertices.size();
+		stats.threads = (unsigned int)std::min<size_t>(threadCount, chunks.size());
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		clear();
+		return !mesh.vertices.empty() && !mesh.indices.empty();
+	}
+
+	const Stats& statistics() const {
+		return stats;
+	}
+
+private:
+	static const int64_t NO_INDEX = INT64_MIN;
+
+	// a face corner as written in the file; relative (negative) indices are stored against the chunk's own
+	// counts and only become file-wide once the chunk offsets are known
+	struct Corner {
+		int64_t position;
+		int64_t normal;
+		bool relativePosition;
+		bool relativeNormal;
+	};
+
+	struct Chunk {
+		const char* begin = nullptr;
+		const char* end = nullptr;
+		std::vector<glm::vec3> positions, colors, normals;
+		std::vector<Corner> corners; // three per triangle
+		size_t positionOffset = 0, normalOffset = 0, cornerOffset = 0;
+		std::vector<uint64_t> keys; // unique (position, normal + 1) pairs in first-use order
+		std::vector<uint32_t> indices; // per corner, into keys
+		std::vector<uint32_t> remap; // keys to global vertex indices
+		bool valid = true;
+	};
+
+	unsigned int threadCount = 1;
+	std::vector<Chunk> chunks;
+	std::vector<glm::vec3> positions, colors, normals;
+	Stats stats;
+
+	// a few chunks per thread so an uneven file (all vertices first, all faces last) still balances
+	void split(const char* data, size_t size) {
+		const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount * 4, size / 4096));
+		chunks.assign(chunkCount, Chunk());
+		const char* const end = data + size;
+		const char* cursor = data;
+		for (size_t i = 0; i < chunkCount; i++) {
+			const char* chunkEnd = i + 1 == chunkCount ? end : std::max(cursor, data + size * (i + 1) / chunkCount);
+			if (chunkEnd < end) {
+				const char* newline = (const char*)memchr(chunkEnd, '\n', end - chunkEnd);
+				chunkEnd = newline ? newline + 1 : end;
+			}
+			chunks[i].begin = cursor;
+			chunks[i].end = chunkEnd;
+			cursor = chunkEnd;
+		}
+	}
+
+	template <typename Function>
+	void forEachChunk(Function&& function) {
+		std::atomic<size_t> next(0);
+		auto worker = [&]() {
+			for (size_t i = next++; i < chunks.size(); i = next++) function(chunks[i]);
+		};
+		std::vector<std::thread> workers;
+		const size_t spawn = std::min<size_t>(threadCount, chunks.size());
+		for (size_t i = 1; i < spawn; i++) workers.emplace_back(worker);
+		worker();
+		for (auto& thread : workers) thread.join();
+	}
+
+	void clear() {
+		chunks.clear();
+		chunks.shrink_to_fit();
+		positions = std::vector<glm::vec3>();
+		colors = std::vector<glm::vec3>();
+		normals = std::vector<glm::vec3>();
+	}
+
+	static const char* skipSpaces(const char* text, const char* end) {
+		while (text < end && (*text == ' ' || *text == '\t')) text++;
+		return text;
+	}
+
+	static bool parseInteger(const char*& text, const char* end, int64_t& value) {
+		const char* cursor = text;
+		const bool negative = cursor < end && *cursor == '-';
+		if (cursor < end && (*cursor == '-' || *cursor == '+')) cursor++;
+		if (cursor == end || *cursor < '0' || *cursor > '9') return false;
+		value = 0;
+		while (cursor < end && *cursor >= '0' && *cursor <= '9') value = value * 10 + (*cursor++ - '0');
+		if (negative) value = -value;
+		text = cursor;
+		return true;
+	}
+
+	// bounded replacement for strtof, which may read past the end of the mapping and is locale dependent
+	static bool parseFloat(const char*& text, const char* end, float& value) {
+		static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+		const char* cursor = text;
+		const bool negative = cursor < end && *cursor == '-';
+		if (cursor < end && (*cursor == '-' || *cursor == '+')) cursor++;
+		uint64_t mantissa = 0;
+		int exponent = 0, digits = 0;
+		for (; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++, digits++) {
+			if (mantissa < 100000000000000000ull) mantissa = mantissa * 10 + (*cursor - '0');
+			else exponent++;
+		}
+		if (cursor < end && *cursor == '.') {
+			for (cursor++; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++, digits++) {
+				if (mantissa < 100000000000000000ull) {
+					mantissa = mantissa * 10 + (*cursor - '0');
+					exponent--;
+				}
+			}
+		}
+		if (digits == 0) return false;
+		if (cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+			const char* exponentText = cursor + 1;
+			int64_t written = 0;
+			if (parseInteger(exponentText, end, written)) {
+				exponent += (int)std::max<int64_t>(-400, std::min<int64_t>(400, written));
+				cursor = exponentText;
+			}
+		}
+		double result = (double)mantissa;
+		for (; exponent > 22; exponent -= 22) result *= powers[22];
+		for (; exponent < -22; exponent += 22) result /= powers[22];
+		result = exponent >= 0 ? result * powers[exponent] : result / powers[-exponent];
+		value = (float)(negative ? -result : result);
+		text = cursor;
+		return true;
+	}
+
+	static void parse(Chunk& chunk) {
+		const char* cursor = chunk.begin;
+		const char* const end = chunk.end;
+		std::vector<Corner> face;
+		while (cursor < end) {
+			const char* lineEnd = (const char*)memchr(cursor, '\n', end - cursor);
+			if (lineEnd == nullptr) lineEnd = end;
+			const char* text = skipSpaces(cursor, lineEnd);
+			cursor = lineEnd + 1;
+			if (lineEnd - text < 2) continue;
+
+			if (text[0] == 'v' && (text[1] == ' ' || text[1] == '\t')) {
+				float values[6] = { 0, 0, 0, 1, 1, 1 };
+				text += 2;
+				for (int i = 0; i < 6; i++) {
+					text = skipSpaces(text, lineEnd);
+					if (!parseFloat(text, lineEnd, values[i])) break;
+				}
+				chunk.positions.push_back(glm::vec3(values[0], values[1], values[2]));
+				chunk.colors.push_back(glm::vec3(values[3], values[4], values[5]));
+			}
+			else if (text[0] == 'v' && text[1] == 'n') {
+				float values[3] = { 0, 0, 0 };
+				text += 2;
+				for (int i = 0; i < 3; i++) {
+					text = skipSpaces(text, lineEnd);
+					if (!parseFloat(text, lineEnd, values[i])) break;
+				}
+				chunk.normals.push_back(glm::vec3(values[0], values[1], values[2]));
+			}
+			else if (text[0] == 'f' && (text[1] == ' ' || text[1] == '\t')) {
+				face.clear();
+				text += 2;
+				for (;;) {
+					text = skipSpaces(text, lineEnd);
+					Corner corner = { 0, NO_INDEX, false, false };
+					int64_t position = 0, texture = 0, normal = 0;
+					if (!parseInteger(text, lineEnd, position)) break;
+					// "v", "v/vt", "v//vn" or "v/vt/vn"; texture coordinates are not used by the engine
+					if (text < lineEnd && *text == '/') {
+						text++;
+						parseInteger(text, lineEnd, texture);
+						if (text < lineEnd && *text == '/') {
+							text++;
+							if (parseInteger(text, lineEnd, normal)) {
+								corner.relativeNormal = normal < 0;
+								corner.normal = normal < 0 ? (int64_t)chunk.normals.size() + normal : normal - 1;
+							}
+						}
+					}
+					corner.relativePosition = position < 0;
+					corner.position = position < 0 ? (int64_t)chunk.positions.size() + position : position - 1;
+					face.push_back(corner);
+				}
+				for (size_t i = 2; i < face.size(); i++) {
+					chunk.corners.push_back(face[0]);
+					chunk.corners.push_back(face[i - 1]);
+					chunk.corners.push_back(face[i]);
+				}
+			}
+		}
+	}
+
+	// makes the corners file-wide, checks them and deduplicates them within the chunk
+	static void resolve(Chunk& chunk, size_t positionCount, size_t normalCount) {
+		std::unordered_map<uint64_t, uint32_t> local;
+		local.reserve(chunk.corners.size() / 3 + 16);
+		chunk.indices.reserve(chunk.corners.size());
+		for (const Corner& corner : chunk.corners) {
+			const int64_t position = corner.position + (corner.relativePosition ? (int64_t)chunk.positionOffset : 0);
+			int64_t normal = corner.normal;
+			if (normal != NO_INDEX && corner.relativeNormal) normal += (int64_t)chunk.normalOffset;
+			if (position < 0 || position >= (int64_t)positionCount || (normal != NO_INDEX && (normal < 0 || normal >= (int64_t)normalCount))) {
+				chunk.valid = false;
+				return;
+			}
+			const uint64_t key = ((uint64_t)position << 32) | (uint64_t)(normal == NO_INDEX ? 0 : normal + 1);
+			const auto inserted = local.emplace(key, (uint32_t)chunk.keys.size());
+			if (inserted.second) chunk.keys.push_back(key);
+			chunk.indices.push_back(inserted.first->second);
+		}
+		chunk.corners = std::vector<Corner>();
+	}
+};
+
+#endif
@@ -0,0 +1,333 @@
+#pragma once
+#ifndef OCCLUSION_CULLING_H
+#define OCCLUSION_CULLING_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "frustum_culling.h"
+#include "job_system.h"
+
+// low resolution software depth buffer for occlusion culling, entirely on the CPU: a few large occluders are
+// rasterized on the job system's threads (4 pixels per step with SSE), reduced into min/max HiZ pyramids, and
+// object boxes are rejected when they lie behind the farthest occluder depth over their screen rectangle.
+// Indexed occluders draw their camera-facing triangles only and pull every silhouette edge in by half a pixel,
+// so a pixel an outline merely clips is never marked; edges shared with another drawn triangle are left alone,
+// so the inside of a mesh has no cracks. Depth is NDC z mapped to [0, 1], smaller is closer
+class OcclusionBuffer {
+public:
+	struct Stats {
+		double rasterMilliseconds = 0;
+		double pyramidMilliseconds = 0;
+		size_t triangles = 0;
+	};
+
+	// adjacency entry of an edge with no usable triangle on its other side
+	static constexpr uint32_t NO_NEIGHBOR = 0xFFFFFFFFu;
+
+	// width and height must be powers of two, width at least 4
+	explicit OcclusionBuffer(unsigned int width = 256, unsigned int height = 128) : width(width), height(height) {
+		unsigned int levelWidth = width, levelHeight = height;
+		while (levelWidth >= 1 && levelHeight >= 1) {
+			levels.push_back({ levelWidth, levelHeight, std::vector<float>((size_t)levelWidth * levelHeight), std::vector<float>((size_t)levelWidth * levelHeight) });
+			if (levelWidth == 1 || levelHeight == 1) break;
+			levelWidth /= 2;
+			levelHeight /= 2;
+		}
+	}
+
+	// starts a frame: drops last frame's occluders and remembers the camera used for every test
+	void begin(const glm::mat4& viewProjection) {
+		camera = viewProjection;
+		triangles.clear();
+		stats = Stats();
+	}
+
+	// triangle on the other side of each edge of an indexed triangle list (edge e of triangle t runs from index
+	// 3t + e to the next one), or NO_NEIGHBOR; edges are matched by index, so equal positions must share one.
+	// Edges used by more than two triangles get no neighbor, which only makes the occluder smaller
+	static void buildAdjacency(const uint32_t* indices, size_t indexCount, std::vector<uint32_t>& adjacency) {
+		struct Edge {
+			uint64_t key;
+			uint32_t slot;
+		};
+		const size_t slots = indexCount / 3 * 3;
+		std::vector<Edge> edges(slots);
+		for (size_t i = 0; i < slots; i++) {
+			const uint32_t a = indices[i], b = indices[i % 3 == 2 ? i - 2 : i + 1];
+			edges[i] = { (uint64_t)std::min(a, b) << 32 | std::max(a, b), (uint32_t)i };
+		}
+		std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.key < b.key; });
+		adjacency.assign(slots, NO_NEIGHBOR);
+		for (size_t i = 0; i < slots;) {
+			size_t run = i + 1;
+			while (run < slots && edges[run].key == edges[i].key) run++;
+			if (run - i == 2) {
+				adjacency[edges[i].slot] = edges[i + 1].slot / 3;
+				adjacency[edges[i + 1].slot] = edges[i].slot / 3;
+			}
+			i = run;
+		}
+	}
+
+	// queues the twelve triangles of a transformed box; the box must lie inside the object it stands for
+	void addBoxOccluder(const glm::mat4& model, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+		glm::vec3 corners[8];
+		for (int i = 0; i < 8; i++) corners[i] = glm::vec3(i & 1 ? boxMax.x : boxMin.x, i & 2 ? boxMax.y : boxMin.y, i & 4 ? boxMax.z : boxMin.z);
+		// counter-clockwise seen from outside
+		static const uint32_t faces[36] = { 0, 3, 1, 0, 2, 3, 4, 7, 6, 4, 5, 7, 0, 5, 4, 0, 1, 5, 2, 7, 3, 2, 6, 7, 0, 6, 2, 0, 4, 6, 1, 7, 5, 1, 3, 7 };
+		static const std::vector<uint32_t> adjacency = [] {
+			std::vector<uint32_t> result;
+			buildAdjacency(faces, 36, result);
+			return result;
+		}();
+		addTriangles(model, corners, 8, faces, 36, adjacency.data());
+	}
+
+	// queues an unconnected triangle list, three positions per triangle; both windings are drawn and every edge
+	// is treated as a silhouette. The triangles must lie on or inside the surface of the object they stand for
+	void addTriangles(const glm::mat4& model, const glm::vec3* positions, size_t count) {
+		const glm::mat4 transform = camera * model;
+		const bool silhouette[3] = { true, true, true };
+		for (size_t i = 0; i + 2 < count; i += 3) {
+			addTriangle(transform * glm::vec4(positions[i], 1.f), transform * glm::vec4(positions[i + 1], 1.f), transform * glm::vec4(positions[i + 2], 1.f), silhouette);
+		}
+	}
+
+	// queues a closed, counter-clockwise indexed mesh with the adjacency buildAdjacency() made for its indices;
+	// every vertex is transformed once. Only triangles facing the camera are drawn, and an edge is a silhouette
+	// when the triangle across it is not drawn
+	void addTriangles(const glm::mat4& model, const glm::vec3* positions, size_t positionCount, const uint32_t* indices, size_t indexCount, const uint32_t* adjacency) {
+		const glm::mat4 transform = camera * model;
+		clipPositions.resize(positionCount);
+		for (size_t i = 0; i < positionCount; i++) clipPositions[i] = transform * glm::vec4(positions[i], 1.f);
+		const size_t triangleCount = indexCount / 3;
+		facing.resize(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++) {
+			const uint32_t* triangle = indices + t * 3;
+			facing[t] = triangle[0] < positionCount && triangle[1] < positionCount && triangle[2] < positionCount
+				&& facesCamera(clipPositions[triangle[0]], clipPositions[triangle[1]], clipPositions[triangle[2]]);
+		}
+		for (size_t t = 0; t < triangleCount; t++) {
+			if (!facing[t]) continue;
+			bool silhouette[3];
+			for (int e = 0; e < 3; e++) silhouette[e] = adjacency[t * 3 + e] == NO_NEIGHBOR || !facing[adjacency[t * 3 + e]];
+			addTriangle(clipPositions[indices[t * 3]], clipPositions[indices[t * 3 + 1]], clipPositions[indices[t * 3 + 2]], silhouette);
+		}
+	}
+
+	// rasterizes everything queued since begin(), in horizontal bands spread over the job system's threads,
+	// then builds the pyramids
+	void rasterize(JobSystem* jobs = nullptr) {
+		auto begin = std::chrono::steady_clock::now();
+		std::vector<float>& depth = levels[0].farthest;
+		std::fill(depth.begin(), depth.end(), 1.f);
+		// one band per thread, every band walks the whole triangle list
+		if (jobs != nullptr) jobs->parallelFor(height, std::max(8u, (height + jobs->threadCount() - 1) / jobs->threadCount()), [this](size_t first, size_t last) { rasterizeBand((unsigned int)first, (unsigned int)last); });
+		else rasterizeBand(0, height);
+		stats.triangles = triangles.size();
+		stats.rasterMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+		begin = std::chrono::steady_clock::now();
+		levels[0].nearest = depth;
+		for (size_t l = 1; l < levels.size(); l++) {
+			const Level& source = levels[l - 1];
+			Level& level = levels[l];
+			for (unsigned int y = 0; y < level.height; y++) {
+				for (unsigned int x = 0; x < level.width; x++) {
+					const size_t a = (size_t)(y * 2) * source.width + x * 2, b = a + source.width;
+					level.farthest[(size_t)y * level.width + x] = std::max(std::max(source.farthest[a], source.farthest[a + 1]), std::max(source.farthest[b], source.farthest[b + 1]));
+					level.nearest[(size_t)y * level.width + x] = std::min(std::min(source.nearest[a], source.nearest[a + 1]), std::min(source.nearest[b], source.nearest[b + 1]));
+				}
+			}
+		}
+		const auto& top = levels.back().nearest;
+		closestOccluder = *std::min_element(top.begin(), top.end());
+		stats.pyramidMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	}
+
+	// false only when the whole box is behind the occluders; boxes crossing the near plane always pass
+	bool isVisible(const glm::vec3& center, const glm::vec3& extent) const {
+		float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, nearest = 1e30f;
+		for (int i = 0; i < 8; i++) {
+			const glm::vec3 corner = center + glm::vec3(i & 1 ? extent.x : -extent.x, i & 2 ? extent.y : -extent.y, i & 4 ? extent.z : -extent.z);
+			const glm::vec4 clip = camera * glm::vec4(corner, 1.f);
+			if (clip.w <= NEAR_W) return true;
+			const float x = (clip.x / clip.w * 0.5f + 0.5f) * width, y = (clip.y / clip.w * 0.5f + 0.5f) * height;
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+			minY = std::min(minY, y);
+			maxY = std::max(maxY, y);
+			nearest = std::min(nearest, clip.z / clip.w * 0.5f + 0.5f);
+		}
+		// anything reaching outside the buffer is not fully covered by it
+		if (minX < 0.f || minY < 0.f || maxX >= (float)width || maxY >= (float)height) return true;
+		// closer than every occluder on screen
+		if (nearest < closestOccluder) return true;
+
+		// the level where the rectangle covers at most a few texels
+		const unsigned int span = (unsigned int)std::max(maxX - minX, maxY - minY);
+		size_t l = 0;
+		while (l + 1 < levels.size() && (span >> l) > 2) l++;
+		const Level& level = levels[l];
+		const unsigned int x0 = (unsigned int)minX >> l, x1 = (unsigned int)maxX >> l, y0 = (unsigned int)minY >> l, y1 = (unsigned int)maxY >> l;
+		for (unsigned int y = y0; y <= y1 && y < level.height; y++) {
+			for (unsigned int x = x0; x <= x1 && x < level.width; x++) {
+				if (nearest <= level.farthest[(size_t)y * level.width + x]) return true;
+			}
+		}
+		return false;
+	}
+
+	// keeps only the visible entries of an index list produced by frustum culling, returns how many were dropped
+	size_t filter(const CullBounds& bounds, std::vector<uint32_t>& visible) const {
+		size_t kept = 0;
+		for (uint32_t index : visible) {
+			const glm::vec3 center(bounds.centerX[index], bounds.centerY[index], bounds.centerZ[index]);
+			const glm::vec3 extent(bounds.extentX[index], bounds.extentY[index], bounds.extentZ[index]);
+			if (isVisible(center, extent)) visible[kept++] = index;
+		}
+		const size_t dropped = visible.size() - kept;
+		visible.resize(kept);
+		return dropped;
+	}
+
+	// level 0 depth, row major from the bottom row up, for inspection and tests
+	const std::vector<float>& depth() const {
+		return levels[0].farthest;
+	}
+
+	unsigned int bufferWidth() const {
+		return width;
+	}
+
+	unsigned int bufferHeight() const {
+		return height;
+	}
+
+	const Stats& statistics() const {
+		return stats;
+	}
+
+private:
+	static constexpr float NEAR_W = 1e-4f;
+
+	struct Level {
+		unsigned int width, height;
+		std::vector<float> farthest; // max depth of the texels below, the occlusion test reads this
+		std::vector<float> nearest; // min depth of the texels below, for early accepts
+	};
+
+	// screen space triangle: pixel x/y and depth per vertex, counter-clockwise, and whether the edge from each
+	// vertex to the next is pulled in by half a pixel
+	struct ScreenTriangle {
+		float x[3], y[3], z[3];
+		bool inset[3];
+	};
+
+	unsigned int width, height;
+	std::vector<Level> levels;
+	std::vector<ScreenTriangle> triangles;
+	std::vector<glm::vec4> clipPositions;
+	std::vector<uint8_t> facing;
+	glm::mat4 camera = glm::mat4(1.f);
+	float closestOccluder = 1.f;
+	Stats stats;
+
+	// in front of the near plane and counter-clockwise on screen; triangles crossing the near plane are dropped
+	// instead of clipped, losing an occluder is always safe
+	static bool facesCamera(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+		if (a.w <= NEAR_W || b.w <= NEAR_W || c.w <= NEAR_W) return false;
+		const float ax = a.x / a.w, ay = a.y / a.w, bx = b.x / b.w, by = b.y / b.w, cx = c.x / c.w, cy = c.y / c.w;
+		return (bx - ax) * (cy - ay) - (cx - ax) * (by - ay) > 0.f;
+	}
+
+	void addTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c, const bool silhouette[3]) {
+		if (a.w <= NEAR_W || b.w <= NEAR_W || c.w <= NEAR_W) return;
+		ScreenTriangle triangle;
+		const glm::vec4* vertices[3] = { &a, &b, &c };
+		for (int i = 0; i < 3; i++) {
+			const glm::vec4& v = *vertices[i];
+			triangle.x[i] = (v.x / v.w * 0.5f + 0.5f) * width;
+			triangle.y[i] = (v.y / v.w * 0.5f + 0.5f) * height;
+			triangle.z[i] = v.z / v.w * 0.5f + 0.5f;
+			triangle.inset[i] = silhouette[i];
+		}
+		const float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+		if (area == 0.f) return;
+		// turned counter-clockwise: the edges 0-1, 1-2, 2-0 become 0-2, 2-1, 1-0
+		if (area < 0.f) {
+			std::swap(triangle.x[1], triangle.x[2]);
+			std::swap(triangle.y[1], triangle.y[2]);
+			std::swap(triangle.z[1], triangle.z[2]);
+			std::swap(triangle.inset[0], triangle.inset[2]);
+		}
+		triangles.push_back(triangle);
+	}
+
+	// edge functions at pixel centers; a pixel is covered when all three are non-negative, and a silhouette edge
+	// is moved inwards by half a pixel so it only passes pixels lying wholly on its inner side
+	void rasterizeBand(unsigned int bandBegin, unsigned int bandEnd) {
+		float* depth = levels[0].farthest.data();
+		for (const ScreenTriangle& t : triangles) {
+			const float minX = std::min(t.x[0], std::min(t.x[1], t.x[2])), maxX = std::max(t.x[0], std::max(t.x[1], t.x[2]));
+			const float minY = std::min(t.y[0], std::min(t.y[1], t.y[2])), maxY = std::max(t.y[0], std::max(t.y[1], t.y[2]));
+			const int x0 = std::max(0, (int)std::floor(minX)) & ~3, x1 = std::min((int)width - 1, (int)std::ceil(maxX));
+			const int y0 = std::max((int)bandBegin, (int)std::floor(minY)), y1 = std::min((int)bandEnd - 1, (int)std::ceil(maxY));
+			if (x0 > x1 || y0 > y1) continue;
+
+			// edge i runs from vertex i to vertex i + 1: e = a * px + b * py + c
+			float edgeA[3], edgeB[3], edgeC[3];
+			for (int i = 0; i < 3; i++) {
+				const int j = (i + 1) % 3;
+				edgeA[i] = t.y[i] - t.y[j];
+				edgeB[i] = t.x[j] - t.x[i];
+				edgeC[i] = t.x[i] * t.y[j] - t.x[j] * t.y[i];
+			}
+			// depth plane z = dzdx * px + dzdy * py + z0
+			const float area = edgeC[0] + edgeC[1] + edgeC[2];
+			const float dzdx = (edgeA[1] * t.z[0] + edgeA[2] * t.z[1] + edgeA[0] * t.z[2]) / area;
+			const float dzdy = (edgeB[1] * t.z[0] + edgeB[2] * t.z[1] + edgeB[0] * t.z[2]) / area;
+			// the plane's farthest value over a pixel, not the value at its center
+			const float z0 = (edgeC[1] * t.z[0] + edgeC[2] * t.z[1] + edgeC[0] * t.z[2]) / area + 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+			for (int i = 0; i < 3; i++) {
+				if (t.inset[i]) edgeC[i] -= 0.5f * (std::fabs(edgeA[i]) + std::fabs(edgeB[i]));
+			}
+
+			for (int y = y0; y <= y1; y++) {
+				const float py = y + 0.5f;
+				float* row = depth + (size_t)y * width;
+#if defined(FRUSTUM_CULLING_SSE)
+				const __m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f), zero = _mm_setzero_ps();
+				for (int x = x0; x <= x1; x += 4) {
+					const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffset);
+					__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+					for (int i = 0; i < 3; i++) {
+						const __m128 edge = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[i]), px), _mm_set1_ps(edgeB[i] * py + edgeC[i]));
+						inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, zero));
+					}
+					if (_mm_movemask_ps(inside) == 0) continue;
+					const __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), px), _mm_set1_ps(dzdy * py + z0));
+					const __m128 stored = _mm_loadu_ps(row + x);
+					const __m128 closer = _mm_min_ps(stored, z);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, stored)));
+				}
+#else
+				for (int x = x0; x <= x1; x++) {
+					const float px = x + 0.5f;
+					bool inside = true;
+					for (int i = 0; i < 3; i++) inside = inside && edgeA[i] * px + edgeB[i] * py + edgeC[i] >= 0.f;
+					if (inside) row[x] = std::min(row[x], dzdx * px + dzdy * py + z0);
+				}
+#endif
+			}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,185 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// scoped CPU zones recorded into one buffer per thread and written as a Chrome trace, which chrome://tracing
+// and ui.perfetto.dev open. A thread only ever appends to its own buffer and publishes each event with one
+// atomic store, so recording takes no lock and costs two clock reads; the lock is only taken the first time a
+// thread records. Buffers have a fixed size given to start(), events beyond it are dropped and counted.
+// Everything goes through the PROFILE_ macros below, which compile to nothing without ENABLE_PROFILER
+class Profiler {
+public:
+	struct Event {
+		const char* name;
+		int64_t begin;
+		int64_t end;
+	};
+
+	// one timeline in the trace: a thread, or a device like the GPU whose events a thread records for it
+	struct Track {
+		std::string name;
+		uint32_t id = 0;
+		std::unique_ptr<Event[]> events;
+		size_t capacity = 0;
+		std::atomic<size_t> count{ 0 };
+		std::atomic<size_t> dropped{ 0 };
+
+		void record(const char* name, int64_t begin, int64_t end) {
+			const size_t index = count.load(std::memory_order_relaxed);
+			if (index == capacity) {
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			events[index] = Event{ name, begin, end };
+			count.store(index + 1, std::memory_order_release);
+		}
+	};
+
+	// starts recording with room for eventsPerTrack events on every track; a run captures at most once
+	static void start(size_t eventsPerTrack = 1 << 16) {
+		State& state = get();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if (state.started) return;
+		state.started = true;
+		state.capacity = eventsPerTrack;
+		state.origin = now();
+		state.recording.store(true, std::memory_order_release);
+	}
+
+	// stops recording; events of zones still open are dropped
+	static void stop() {
+		get().recording.store(false, std::memory_order_release);
+	}
+
+	static bool recording() {
+		return get().recording.load(std::memory_order_relaxed);
+	}
+
+	// nanoseconds on the steady clock
+	static int64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// name of the calling thread in the trace, set before its first zone
+	static void setThreadName(const std::string& name) {
+		threadName() = name;
+	}
+
+	static void record(const char* name, int64_t begin, int64_t end) {
+		Track* track = threadTrack();
+		if (track == nullptr) track = threadTrack() = addTrack(threadName().empty() ? "thread" : threadName());
+		if (track != nullptr) track->record(name, begin, end);
+	}
+
+	// an extra timeline filled by one thread on behalf of something else, null when not recording
+	static Track* addTrack(const std::string& name) {
+		State& state = get();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if (!state.started) return nullptr;
+		auto track = std::make_unique<Track>();
+		track->name = name;
+		track->id = (uint32_t)state.tracks.size() + 1;
+		track->events = std::make_unique<Event[]>(state.capacity);
+		track->capacity = state.capacity;
+		state.tracks.push_back(std::move(track));
+		return state.tracks.back().get();
+	}
+
+	// every published event as complete ("X") events with microsecond times from start(); call after stop()
+	static bool writeChromeTrace(const std::string& path) {
+		State& state = get();
+		FILE* file = fopen(path.c_str(), "w");
+		if (file == NULL) {
+			std::cout << "ERROR::PROFILER::FAILED_TO_WRITE: " << path << std::endl;
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(state.mutex);
+		size_t events = 0, dropped = 0;
+		fprintf(file, "{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"3D_VS\"}}");
+		for (const auto& track : state.tracks) {
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", track->id, track->name.c_str());
+			fprintf(file, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"sort_index\":%u}}", track->id, track->id);
+			const size_t count = track->count.load(std::memory_order_acquire);
+			for (size_t e = 0; e < count; e++) {
+				const Event& event = track->events[e];
+				fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.name, track->id,
+					(event.begin - state.origin) / 1000.0, std::max<int64_t>(0, event.end - event.begin) / 1000.0);
+			}
+			events += count;
+			dropped += track->dropped.load(std::memory_order_relaxed);
+		}
+		fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+		fclose(file);
+		std::cout << "Trace: " << events << " events on " << state.tracks.size() << " tracks written to " << path;
+		if (dropped > 0) std::cout << ", " << dropped << " dropped for lack of space";
+		std::cout << std::endl;
+		return true;
+	}
+
+private:
+	// tracks are never freed while the process runs, so a thread finishing a zone after stop() is still safe
+	struct State {
+		std::mutex mutex;
+		std::atomic<bool> recording{ false };
+		bool started = false;
+		size_t capacity = 0;
+		int64_t origin = 0;
+		std::vector<std::unique_ptr<Track>> tracks;
+	};
+
+	static State& get() {
+		static State state;
+		return state;
+	}
+
+	static Track*& threadTrack() {
+		static thread_local Track* track = nullptr;
+		return track;
+	}
+
+	static std::string& threadName() {
+		static thread_local std::string name;
+		return name;
+	}
+};
+
+// times the enclosing scope; name must outlive the capture, a string literal in practice
+class ProfileZone {
+public:
+	explicit ProfileZone(const char* name) : name(name), begin(Profiler::recording() ? Profiler::now() : 0) {}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+	~ProfileZone() {
+		if (begin != 0 && Profiler::recording()) Profiler::record(name, begin, Profiler::now());
+	}
+
+private:
+	const char* name;
+	int64_t begin;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler::setThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
+
+#endif
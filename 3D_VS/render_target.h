@@ -0,0 +1,69 @@
+#pragma once
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// offscreen framebuffer with an RGBA8 color and a depth attachment, drawn into instead of the window when there
+// is no window to show, and read back to validate what was rendered. Reverse-Z wants GL_DEPTH_COMPONENT32F depth
+class RenderTarget {
+public:
+	unsigned int ID = 0;
+
+	RenderTarget(int width, int height, GLenum depthFormat = GL_DEPTH_COMPONENT24) : width(width), height(height) {
+		glCreateRenderbuffers(1, &color);
+		glNamedRenderbufferStorage(color, GL_RGBA8, width, height);
+		glCreateRenderbuffers(1, &depth);
+		glNamedRenderbufferStorage(depth, depthFormat, width, height);
+		glCreateFramebuffers(1, &ID);
+		glNamedFramebufferRenderbuffer(ID, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+		glNamedFramebufferRenderbuffer(ID, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+		if (glCheckNamedFramebufferStatus(ID, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "ERROR::RENDER_TARGET::INCOMPLETE_FRAMEBUFFER" << std::endl;
+		}
+	}
+
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget& operator=(const RenderTarget&) = delete;
+
+	~RenderTarget() {
+		glDeleteFramebuffers(1, &ID);
+		glDeleteRenderbuffers(1, &depth);
+		glDeleteRenderbuffers(1, &color);
+	}
+
+	void bind() const {
+		glBindFramebuffer(GL_FRAMEBUFFER, ID);
+		glViewport(0, 0, width, height);
+	}
+
+	// the color attachment as a binary PPM, top row first; waits for rendering to finish
+	bool savePpm(const std::string& path) const {
+		std::vector<unsigned char> pixels((size_t)width * height * 3);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glNamedFramebufferReadBuffer(ID, GL_COLOR_ATTACHMENT0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, ID);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+		FILE* file = fopen(path.c_str(), "wb");
+		if (file == NULL) {
+			std::cout << "ERROR::RENDER_TARGET::FAILED_TO_WRITE: " << path << std::endl;
+			return false;
+		}
+		fprintf(file, "P6\n%d %d\n255\n", width, height);
+		// GL rows start at the bottom
+		for (int y = height - 1; y >= 0; y--) fwrite(pixels.data() + (size_t)y * width * 3, 1, (size_t)width * 3, file);
+		fclose(file);
+		return true;
+	}
+
+private:
+	int width, height;
+	unsigned int color = 0, depth = 0;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef SCENE_COMPONENTS_H
+#define SCENE_COMPONENTS_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdint>
+
+// components of the objects drawn by MainEngine, stored in an ecs.h World
+
+// the entity's node in the scene's TransformHierarchy, which holds its world matrix
+struct SceneNode {
+	uint32_t node;
+};
+
+// placement of an entity relative to its parent node: scale, then a rotation about an axis, then the translation;
+// systems that change it write localMatrix() back to the hierarchy
+struct Transform {
+	glm::vec3 position;
+	float angle;
+	glm::vec3 axis;
+	float scale;
+};
+
+// turns the entity about its Transform axis at a fixed speed in radians per second; the simulation advances
+// it, phase is only the angle it starts at
+struct Spin {
+	float speed;
+	float phase;
+};
+
+// the entity's Transform as of the previous simulation step, so frames drawn between two steps can blend them
+struct PreviousTransform {
+	Transform transform;
+};
+
+// half extent of a box around the node's origin that holds the mesh in any orientation, before world scale
+struct Bounds {
+	glm::vec3 extent;
+};
+
+// mesh drawn for the entity, as an index into the scene's mesh table, and the level of detail it used last
+// frame for the LOD hysteresis
+struct MeshRenderer {
+	uint32_t mesh;
+	uint32_t lod;
+};
+
+// tint multiplied into the mesh's vertex colors
+struct Material {
+	glm::vec4 color;
+};
+
+// placement alpha of the way from previous to current; both are expected to share the rotation axis
+inline Transform interpolate(const Transform& previous, const Transform& current, float alpha) {
+	Transform result = current;
+	result.position = glm::mix(previous.position, current.position, alpha);
+	result.angle = glm::mix(previous.angle, current.angle, alpha);
+	result.scale = glm::mix(previous.scale, current.scale, alpha);
+	return result;
+}
+
+inline glm::mat4 localMatrix(const Transform& transform) {
+	const glm::mat4 model = glm::rotate(glm::translate(glm::mat4(1.f), transform.position), transform.angle, transform.axis);
+	return glm::scale(model, glm::vec3(transform.scale));
+}
+
+#endif
@@ -9,13 +9,174 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+// fixed uniform block binding points shared by every program, see uniform_buffer.h
+const GLuint CAMERA_BLOCK_BINDING = 0;
+
+// GLSL text of every stage, geometry is optional
+struct ShaderSource {
+	std::string vertex, fragment, geometry;
+};
+
+// KHR_parallel_shader_compile is not part of the generated loader, so its entry point is resolved here
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+
+// true once the driver has agreed to compile and link on its own threads
+inline bool parallelShaderCompile = false;
+
+// enables driver side compile threads when KHR/ARB_parallel_shader_compile is available
+inline bool enableParallelShaderCompile(GLADloadproc load) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count && !parallelShaderCompile; i++) {
+		const char* name = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+		const bool khr = strcmp(name, "GL_KHR_parallel_shader_compile") == 0;
+		if (!khr && strcmp(name, "GL_ARB_parallel_shader_compile") != 0) continue;
+		const auto maxThreads = (PFNMAXSHADERCOMPILERTHREADSPROC)load(khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB");
+		if (maxThreads) maxThreads(0xFFFFFFFFu); // let the driver pick
+		parallelShaderCompile = true;
+	}
+	return parallelShaderCompile;
+}
+
+// compile and link that were issued but whose status hasn't been read yet
+struct ShaderBuild {
+	GLuint program = 0;
+	GLuint stages[3] = { 0, 0, 0 };
+	unsigned int polls = 0;
+	bool active() const { return program != 0; }
+};
+
+// typed handle to a uniform slot of one Shader, resolved once so hot paths skip glGetUniformLocation;
+// the slot survives program swaps on reload
+template <typename T>
+struct Uniform {
+	int slot = -1;
+	bool valid() const { return slot >= 0; }
+};
+
+// GL type enum matching each handle type, used to validate lookups against the reflected table
+template <typename T> constexpr GLenum uniformGLType();
+template <> constexpr GLenum uniformGLType<bool>() { return GL_BOOL; }
+template <> constexpr GLenum uniformGLType<int>() { return GL_INT; }
+template <> constexpr GLenum uniformGLType<float>() { return GL_FLOAT; }
+template <> constexpr GLenum uniformGLType<glm::vec2>() { return GL_FLOAT_VEC2; }
+template <> constexpr GLenum uniformGLType<glm::vec3>() { return GL_FLOAT_VEC3; }
+template <> constexpr GLenum uniformGLType<glm::vec4>() { return GL_FLOAT_VEC4; }
+template <> constexpr GLenum uniformGLType<glm::mat2>() { return GL_FLOAT_MAT2; }
+template <> constexpr GLenum uniformGLType<glm::mat3>() { return GL_FLOAT_MAT3; }
+template <> constexpr GLenum uniformGLType<glm::mat4>() { return GL_FLOAT_MAT4; }
 
 class Shader {
 public:
 	unsigned int ID;
 
-	Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr) {
-		std::string vertexCode, fragmentCode, geometryCode;
+	// one entry per active uniform, sorted by name
+	struct UniformInfo {
+		std::string name;
+		GLint location;
+		GLenum type;
+		GLint size;
+	};
+
+	Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr) : Shader(readSource(vertexPath, fragmentPath, geometryPath)) {}
+
+	// deferred builds only issue the compile, the status is read by poll(), finish() or the first use()
+	explicit Shader(const ShaderSource& source, bool deferred = false) : ID(0) {
+		build(source);
+		if (!deferred) finish();
+	}
+
+	// wraps an already linked program, e.g. one restored from a program binary
+	explicit Shader(GLuint linkedProgram) : ID(0) {
+		replaceProgram(linkedProgram);
+	}
+
+	// issues compile and link without reading any status, so the driver can work in the background;
+	// the current program stays in use until the new one is finished
+	void build(const ShaderSource& source) {
+		discardBuild();
+		const char* vShaderCode = source.vertex.c_str();
+		const char* fShaderCode = source.fragment.c_str();
+		// compile shaders
+		pending.stages[0] = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(pending.stages[0], 1, &vShaderCode, NULL);
+		glCompileShader(pending.stages[0]);
+
+		pending.stages[1] = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(pending.stages[1], 1, &fShaderCode, NULL);
+		glCompileShader(pending.stages[1]);
+
+		if (!source.geometry.empty()) {
+			const char* gShaderCode = source.geometry.c_str();
+			pending.stages[2] = glCreateShader(GL_GEOMETRY_SHADER);
+			glShaderSource(pending.stages[2], 1, &gShaderCode, NULL);
+			glCompileShader(pending.stages[2]);
+		}
+
+		pending.program = glCreateProgram();
+		// lets ShaderLibrary fetch the linked binary for its on-disk cache
+		glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		for (GLuint stage : pending.stages) if (stage) glAttachShader(pending.program, stage);
+		glLinkProgram(pending.program);
+		pending.polls = 0;
+	}
+
+	// deletes the program and any build in flight
+	void release() {
+		discardBuild();
+		if (ID != 0) glDeleteProgram(ID);
+		ID = 0;
+	}
+
+	bool building() const {
+		return pending.active();
+	}
+
+	// true when finish() would not block; without the parallel compile extension the status is
+	// read one poll later, which still leaves the driver a frame to work
+	bool buildReady() {
+		if (!pending.active()) return false;
+		if (!parallelShaderCompile) return pending.polls++ > 0;
+		GLint done = GL_FALSE;
+		glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &done);
+		return done == GL_TRUE;
+	}
+
+	// finishes the pending build if it is ready, returns true when a new program was swapped in
+	bool poll() {
+		return buildReady() && finish();
+	}
+
+	// reads the pending build's status, blocking if needed; on failure the old program is kept
+	bool finish() {
+		if (!pending.active()) return false;
+		static const char* stageNames[3] = { "VERTEX", "FRAGMENT", "GEOMETRY" };
+		bool success = true;
+		for (int i = 0; i < 3; i++) {
+			if (pending.stages[i]) success = checkCompileErrors(pending.stages[i], stageNames[i]) && success;
+		}
+		success = checkCompileErrors(pending.program, "PROGRAM") && success;
+
+		const GLuint program = pending.program;
+		pending.program = 0;
+		discardBuild();
+		if (!success) {
+			glDeleteProgram(program);
+			return false;
+		}
+		replaceProgram(program);
+		return true;
+	}
+
+	static ShaderSource readSource(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr) {
+		ShaderSource source;
 		std::ifstream vShaderFile, fShaderFile, gShaderFile;
 
 		vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
@@ -34,109 +195,208 @@ public:
 			vShaderFile.close();
 			fShaderFile.close();
 
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
+			source.vertex = vShaderStream.str();
+			source.fragment = fShaderStream.str();
 
 			if (geometryPath != nullptr) {
 				gShaderFile.open(geometryPath);
 				std::stringstream gShaderStream;
 				gShaderStream << gShaderFile.rdbuf();
 				gShaderFile.close();
-				geometryCode = gShaderStream.str();
+				source.geometry = gShaderStream.str();
 			}
 		}
 		catch (std::ifstream::failure& e) {
 			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
 		}
+		return source;
+	}
 
-		const char* vShaderCode = vertexCode.c_str();
-		const char* fShaderCode = fragmentCode.c_str();
-		// compile shaders
-		unsigned int vertex, fragment;
-
-		vertex = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertex, 1, &vShaderCode, NULL);
-		glCompileShader(vertex);
-		checkCompileErrors(vertex, "VERTEX");
-
-		fragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment, 1, &fShaderCode, NULL);
-		glCompileShader(fragment);
-		checkCompileErrors(fragment, "FRAGMENT");
-
-		unsigned int geometry;
-		if (geometryPath != nullptr) {
-			const char* gShaderCode = geometryCode.c_str();
-			geometry = glCreateShader(GL_GEOMETRY_SHADER);
-			glShaderSource(geometry, 1, &gShaderCode, NULL);
-			glCompileShader(geometry);
-			checkCompileErrors(geometry, "GEOMETRY");
-		}
+	void use() {
+		// nothing to draw with yet, so the first build has to be waited for
+		if (ID == 0) finish();
+		glUseProgram(ID);
+	}
 
-		ID = glCreateProgram();
-		glAttachShader(ID, vertex);
-		glAttachShader(ID, fragment);
-		if (geometryPath != nullptr) glAttachShader(ID, geometry);
-		glLinkProgram(ID);
-		checkCompileErrors(ID, "PROGRAM");
+	// active uniforms as reported by the driver at link time
+	const std::vector<UniformInfo>& uniforms() const {
+		return uniformTable;
+	}
 
-		// delete the shaders as they're linked into program now and no longer necessery
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
-		if (geometryPath != nullptr) glDeleteShader(geometry);
+	// cached location of a uniform, -1 if it is not active in this program
+	GLint location(const std::string& name) const {
+		const auto it = std::lower_bound(uniformTable.begin(), uniformTable.end(), name, [](const UniformInfo& info, const std::string& key) { return info.name < key; });
+		return it != uniformTable.end() && it->name == name ? it->location : -1;
 	}
 
-	void use() {
-		glUseProgram(ID);
+	// registers a typed handle; it is resolved now if a program is linked and again after every swap,
+	// with a warning when the uniform is missing or declared with another type
+	template <typename T>
+	Uniform<T> uniform(const std::string& name) {
+		Uniform<T> handle;
+		for (size_t i = 0; i < slotNames.size(); i++) {
+			if (slotNames[i] == name && slotTypes[i] == uniformGLType<T>()) {
+				handle.slot = (int)i;
+				return handle;
+			}
+		}
+		handle.slot = (int)slotNames.size();
+		slotNames.push_back(name);
+		slotTypes.push_back(uniformGLType<T>());
+		slotLocations.push_back(-1);
+		if (ID != 0) resolveSlot(handle.slot);
+		return handle;
+	}
+
+	GLint slotLocation(int slot) const {
+		return slot >= 0 ? slotLocations[slot] : -1;
 	}
-	// utility uniform functions
+
+	// handle based setters, no string lookup and no driver query
+	// ------------------------------------------------------------------------
+	void set(Uniform<bool> handle, bool value) const {
+		glUniform1i(slotLocation(handle.slot), (int)value);
+	}
+	void set(Uniform<int> handle, int value) const {
+		glUniform1i(slotLocation(handle.slot), value);
+	}
+	void set(Uniform<float> handle, float value) const {
+		glUniform1f(slotLocation(handle.slot), value);
+	}
+	void set(Uniform<glm::vec2> handle, const glm::vec2& value) const {
+		glUniform2fv(slotLocation(handle.slot), 1, &value[0]);
+	}
+	void set(Uniform<glm::vec3> handle, const glm::vec3& value) const {
+		glUniform3fv(slotLocation(handle.slot), 1, &value[0]);
+	}
+	void set(Uniform<glm::vec4> handle, const glm::vec4& value) const {
+		glUniform4fv(slotLocation(handle.slot), 1, &value[0]);
+	}
+	void set(Uniform<glm::mat2> handle, const glm::mat2& mat) const {
+		glUniformMatrix2fv(slotLocation(handle.slot), 1, GL_FALSE, &mat[0][0]);
+	}
+	void set(Uniform<glm::mat3> handle, const glm::mat3& mat) const {
+		glUniformMatrix3fv(slotLocation(handle.slot), 1, GL_FALSE, &mat[0][0]);
+	}
+	void set(Uniform<glm::mat4> handle, const glm::mat4& mat) const {
+		glUniformMatrix4fv(slotLocation(handle.slot), 1, GL_FALSE, &mat[0][0]);
+	}
+
+	// utility uniform functions, resolved by name through the reflected table
 	// ------------------------------------------------------------------------
 	void setBool(const std::string& name, bool value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		glUniform1i(location(name), (int)value);
 	}
 	// ------------------------------------------------------------------------
 	void setInt(const std::string& name, int value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1i(location(name), value);
 	}
 	// ------------------------------------------------------------------------
 	void setFloat(const std::string& name, float value) const {
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1f(location(name), value);
 	}
 	// ------------------------------------------------------------------------
 	void setVec2(const std::string& name, const glm::vec2& value) const {
-		glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform2fv(location(name), 1, &value[0]);
 	}
 	void setVec2(const std::string& name, float x, float y) const {
-		glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+		glUniform2f(location(name), x, y);
 	}
 	// ------------------------------------------------------------------------
 	void setVec3(const std::string& name, const glm::vec3& value) const {
-		glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform3fv(location(name), 1, &value[0]);
 	}
 	void setVec3(const std::string& name, float x, float y, float z) const {
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+		glUniform3f(location(name), x, y, z);
 	}
 	// ------------------------------------------------------------------------
 	void setVec4(const std::string& name, const glm::vec4& value) const {
-		glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform4fv(location(name), 1, &value[0]);
 	}
 	void setVec4(const std::string& name, float x, float y, float z, float w) {
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+		glUniform4f(location(name), x, y, z, w);
 	}
 	// ------------------------------------------------------------------------
 	void setMat2(const std::string& name, const glm::mat2& mat) const {
-		glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]);
 	}
 	// ------------------------------------------------------------------------
 	void setMat3(const std::string& name, const glm::mat3& mat) const {
-		glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]);
 	}
 	// ------------------------------------------------------------------------
 	void setMat4(const std::string& name, const glm::mat4& mat) const {
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
 	}
 private:
-	void checkCompileErrors(GLuint shader, std::string type) {
+	std::vector<UniformInfo> uniformTable;
+	// handle slots: names and types stay fixed, locations are refreshed whenever the program changes
+	std::vector<std::string> slotNames;
+	std::vector<GLenum> slotTypes;
+	std::vector<GLint> slotLocations;
+	ShaderBuild pending;
+
+	void discardBuild() {
+		for (GLuint& stage : pending.stages) {
+			if (stage) glDeleteShader(stage);
+			stage = 0;
+		}
+		if (pending.program) glDeleteProgram(pending.program);
+		pending.program = 0;
+	}
+
+	// swaps in a linked program and refreshes everything derived from it
+	void replaceProgram(GLuint program) {
+		if (ID != 0) glDeleteProgram(ID);
+		ID = program;
+		bindUniformBlocks();
+		reflectUniforms();
+		for (size_t i = 0; i < slotNames.size(); i++) resolveSlot((int)i);
+	}
+
+	void resolveSlot(int slot) {
+		const auto it = std::lower_bound(uniformTable.begin(), uniformTable.end(), slotNames[slot], [](const UniformInfo& info, const std::string& key) { return info.name < key; });
+		if (it == uniformTable.end() || it->name != slotNames[slot]) {
+			std::cout << "WARNING::SHADER::UNIFORM_NOT_ACTIVE: " << slotNames[slot] << std::endl;
+			slotLocations[slot] = -1;
+			return;
+		}
+		if (it->type != slotTypes[slot]) std::cout << "WARNING::SHADER::UNIFORM_TYPE_MISMATCH: " << slotNames[slot] << std::endl;
+		slotLocations[slot] = it->location;
+	}
+
+	// attaches known blocks to their shared binding points, for shaders that don't declare layout(binding)
+	void bindUniformBlocks() {
+		const GLuint cameraIndex = glGetUniformBlockIndex(ID, "Camera");
+		if (cameraIndex != GL_INVALID_INDEX) glUniformBlockBinding(ID, cameraIndex, CAMERA_BLOCK_BINDING);
+	}
+
+	// lists every active uniform once after linking; arrays are also reachable without the "[0]" suffix
+	void reflectUniforms() {
+		uniformTable.clear();
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<GLchar> nameBuffer(maxLength > 0 ? maxLength : 1);
+
+		for (GLint i = 0; i < count; i++) {
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+			std::string name(nameBuffer.data(), length);
+			// uniforms inside blocks have no location and are set through their buffer
+			const GLint location = glGetUniformLocation(ID, name.c_str());
+			if (location < 0) continue;
+			if (size > 1 && name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+				uniformTable.push_back({ name.substr(0, name.size() - 3), location, type, size });
+			}
+			uniformTable.push_back({ std::move(name), location, type, size });
+		}
+		std::sort(uniformTable.begin(), uniformTable.end(), [](const UniformInfo& a, const UniformInfo& b) { return a.name < b.name; });
+	}
+
+	bool checkCompileErrors(GLuint shader, std::string type) {
 		GLint success;
 		GLchar infoLog[1024];
 		if (type != "PROGRAM") {
@@ -153,6 +413,7 @@ private:
 				std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
 			}
 		}
+		return success != 0;
 	}
 };
 
@@ -0,0 +1,280 @@
+#pragma once
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "file_watcher.h"
+#include "shader_handler.h"
+
+// owns every linked program, deduplicated by source hash and backed by an on-disk program binary cache;
+// compiles are issued in batches and their status read later, edited sources are rebuilt in the background
+class ShaderLibrary {
+public:
+	// counters for the startup report
+	struct Stats {
+		unsigned int compiled = 0;
+		unsigned int fromBinary = 0;
+		unsigned int deduplicated = 0;
+		unsigned int rejectedBinaries = 0;
+		double milliseconds = 0;
+	};
+
+	explicit ShaderLibrary(const std::string& cacheDirectory = "shader_cache", bool useBinaryCache = true) : cacheDirectory(cacheDirectory) {
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		binaryCache = useBinaryCache && formats > 0;
+		if (!binaryCache) return;
+
+		// binaries are only valid for the exact driver that produced them
+		driverHash = hashString(FNV_OFFSET, (const char*)glGetString(GL_VENDOR));
+		driverHash = hashString(driverHash, (const char*)glGetString(GL_RENDERER));
+		driverHash = hashString(driverHash, (const char*)glGetString(GL_VERSION));
+
+		std::error_code error;
+		std::filesystem::create_directories(cacheDirectory, error);
+		if (error) {
+			std::cout << "WARNING::SHADER_LIBRARY::CACHE_DIRECTORY_UNAVAILABLE: " << cacheDirectory << std::endl;
+			binaryCache = false;
+		}
+	}
+
+	ShaderLibrary(const ShaderLibrary&) = delete;
+	ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+	// returns the program built from these files, shared with every earlier request for identical sources;
+	// a fresh compile is only issued here, call finishPending() once the whole batch is loaded
+	Shader& load(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr) {
+		const auto begin = std::chrono::steady_clock::now();
+		const ShaderSource source = Shader::readSource(vertexPath, fragmentPath, geometryPath);
+		const uint64_t key = hashSource(source);
+
+		auto it = byHash.find(key);
+		if (it != byHash.end()) {
+			stats.deduplicated++;
+			return *it->second->shader;
+		}
+
+		std::unique_ptr<Entry> entry(new Entry);
+		entry->paths[0] = vertexPath;
+		entry->paths[1] = fragmentPath;
+		if (geometryPath != nullptr) entry->paths[2] = geometryPath;
+		entry->key = key;
+		entry->shader = binaryCache ? loadBinary(key) : nullptr;
+		if (!entry->shader) {
+			entry->shader.reset(new Shader(source, true));
+			entry->saveWhenBuilt = binaryCache;
+			stats.compiled++;
+		}
+		else stats.fromBinary++;
+		if (watcher) watchEntry(*entry);
+
+		Shader& result = *entry->shader;
+		byHash[key] = entry.get();
+		entries.push_back(std::move(entry));
+		stats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		return result;
+	}
+
+	// reads the status of every compile still in flight, blocking until all of them are done
+	void finishPending() {
+		const auto begin = std::chrono::steady_clock::now();
+		for (auto& entry : entries) {
+			if (entry->shader->building()) completeBuild(*entry);
+		}
+		stats.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	}
+
+	// watches every loaded source file, edits are picked up by update()
+	void enableHotReload() {
+		if (watcher) return;
+		watcher.reset(new FileWatcher);
+		for (auto& entry : entries) watchEntry(*entry);
+	}
+
+	// called once per frame: starts rebuilds for edited files and swaps in programs whose build finished,
+	// never waits on the driver; true when a build finished, since the new program may reuse an old name
+	bool update() {
+		if (watcher) {
+			for (const auto& path : watcher->poll()) reload(path);
+		}
+		bool rebuilt = false;
+		for (auto& entry : entries) {
+			if (!entry->shader->building() || !entry->shader->buildReady()) continue;
+			completeBuild(*entry);
+			rebuilt = true;
+		}
+		return rebuilt;
+	}
+
+	const Stats& statistics() const {
+		return stats;
+	}
+
+	void clear() {
+		for (auto& entry : entries) entry->shader->release();
+		byHash.clear();
+		entries.clear();
+	}
+
+	~ShaderLibrary() {
+		clear();
+	}
+
+private:
+	static constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+	static constexpr uint64_t FNV_PRIME = 1099511628211ull;
+	static constexpr uint32_t CACHE_MAGIC = 0x42505356; // "VSPB"
+	static constexpr uint32_t CACHE_VERSION = 1;
+
+	// header written in front of every cached binary
+	struct CacheHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint32_t format;
+		uint32_t length;
+	};
+
+	// one linked program and the files it was built from
+	struct Entry {
+		std::string paths[3];
+		uint64_t key = 0;
+		std::unique_ptr<Shader> shader;
+		bool saveWhenBuilt = false;
+		bool reloading = false;
+	};
+
+	std::string cacheDirectory;
+	bool binaryCache = false;
+	uint64_t driverHash = FNV_OFFSET;
+	std::vector<std::unique_ptr<Entry>> entries;
+	std::unordered_map<uint64_t, Entry*> byHash;
+	std::unique_ptr<FileWatcher> watcher;
+	Stats stats;
+
+	void watchEntry(const Entry& entry) {
+		for (const auto& path : entry.paths) {
+			if (!path.empty()) watcher->watch(path);
+		}
+	}
+
+	void completeBuild(Entry& entry) {
+		const bool success = entry.shader->finish();
+		if (success && entry.saveWhenBuilt) saveBinary(entry.key, entry.shader->ID);
+		if (entry.reloading) {
+			std::cout << (success ? "Reloaded " : "Reload failed, keeping the previous program: ") << entry.paths[0] << " + " << entry.paths[1] << std::endl;
+		}
+		entry.saveWhenBuilt = false;
+		entry.reloading = false;
+	}
+
+	// issues a rebuild of every program using this file, the old program keeps drawing meanwhile
+	void reload(const std::string& path) {
+		for (auto& entry : entries) {
+			if (path != entry->paths[0] && path != entry->paths[1] && path != entry->paths[2]) continue;
+			const ShaderSource source = Shader::readSource(entry->paths[0].c_str(), entry->paths[1].c_str(), entry->paths[2].empty() ? nullptr : entry->paths[2].c_str());
+			// editors may truncate before writing, another event follows once the file is complete
+			if (source.vertex.empty() || source.fragment.empty()) continue;
+			const uint64_t key = hashSource(source);
+			if (key == entry->key) continue;
+
+			const auto it = byHash.find(entry->key);
+			if (it != byHash.end() && it->second == entry.get()) byHash.erase(it);
+			entry->key = key;
+			if (!byHash.count(key)) byHash[key] = entry.get();
+			entry->shader->build(source);
+			entry->saveWhenBuilt = binaryCache;
+			entry->reloading = true;
+		}
+	}
+
+	static uint64_t hashString(uint64_t hash, const char* text) {
+		if (text == nullptr) return hash;
+		for (; *text; text++) hash = (hash ^ (unsigned char)*text) * FNV_PRIME;
+		// terminator keeps "ab"+"c" and "a"+"bc" apart
+		return hash * FNV_PRIME;
+	}
+
+	static uint64_t hashSource(const ShaderSource& source) {
+		uint64_t hash = hashString(FNV_OFFSET, source.vertex.c_str());
+		hash = hashString(hash, source.fragment.c_str());
+		return hashString(hash, source.geometry.c_str());
+	}
+
+	std::string cachePath(uint64_t key) const {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)(key ^ driverHash));
+		return cacheDirectory + "/" + name;
+	}
+
+	// restores a program from the cache, nullptr when missing, stale or rejected by the driver
+	std::unique_ptr<Shader> loadBinary(uint64_t key) {
+		const std::string path = cachePath(key);
+		std::ifstream file(path, std::ios::binary);
+		if (!file) return nullptr;
+
+		CacheHeader header{};
+		file.read((char*)&header, sizeof(header));
+		if (!file || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.key != (key ^ driverHash)) {
+			file.close();
+			discard(path);
+			return nullptr;
+		}
+		std::vector<char> binary(header.length);
+		file.read(binary.data(), binary.size());
+		if (!file) {
+			file.close();
+			discard(path);
+			return nullptr;
+		}
+
+		const GLuint program = glCreateProgram();
+		glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+		GLint success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success) {
+			// driver updates can invalidate binaries, fall back to compiling from source
+			glDeleteProgram(program);
+			file.close();
+			discard(path);
+			stats.rejectedBinaries++;
+			return nullptr;
+		}
+		return std::unique_ptr<Shader>(new Shader(program));
+	}
+
+	void saveBinary(uint64_t key, GLuint program) const {
+		GLint linked = 0, length = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (!linked || length <= 0) return;
+
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		glGetProgramBinary(program, length, &length, &format, binary.data());
+
+		const CacheHeader header{ CACHE_MAGIC, CACHE_VERSION, key ^ driverHash, format, (uint32_t)length };
+		std::ofstream file(cachePath(key), std::ios::binary | std::ios::trunc);
+		file.write((const char*)&header, sizeof(header));
+		file.write(binary.data(), length);
+	}
+
+	static void discard(const std::string& path) {
+		std::error_code error;
+		std::filesystem::remove(path, error);
+	}
+};
+
+#endif
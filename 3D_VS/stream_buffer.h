@@ -0,0 +1,181 @@
+#pragma once
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// persistently mapped ring for per-frame dynamic data (uniform blocks, instance streams, dynamic geometry);
+// the storage is split into one region per frame in flight, and a region is only rewritten after its fence
+// has signalled, so uploads never re-specify or orphan a buffer
+class StreamBuffer {
+public:
+	static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+	unsigned int ID = 0;
+
+	// a reserved slice of the current frame's region, data is written straight into the mapping
+	struct Allocation {
+		void* data = nullptr;
+		GLintptr offset = 0;
+		GLsizeiptr size = 0;
+		explicit operator bool() const { return data != nullptr; }
+	};
+
+	explicit StreamBuffer(GLsizeiptr frameSize = 1 << 20) {
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		uniformAlignment = alignment;
+		create(frameSize);
+	}
+
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+	// grows every region to at least frameSize bytes; waits for the GPU, so call it outside the frame loop
+	void reserve(GLsizeiptr frameSize) {
+		if (frameSize <= regionSize) return;
+		for (GLsync& fence : fences) wait(fence);
+		destroy();
+		create(frameSize);
+	}
+
+	// waits until the GPU is done with the region this frame reuses, normally without blocking; expectedSize is
+	// an upper bound of what the frame will allocate, when the caller knows it. False when the storage could not
+	// be mapped, in which case nothing may be allocated and the frame should be skipped
+	bool beginFrame(GLsizeiptr expectedSize = 0) {
+		// a region too small for this frame, or one that overflowed last time, is grown before anything is
+		// written into it; storage that failed to map is tried again, at the size last asked for unless the frame
+		// says what it needs
+		const GLsizeiptr needed = std::max(peakRequest, expectedSize);
+		grown = needed > regionSize || mapped == nullptr;
+		if (grown) reserve(needed > 0 ? needed + needed / 2 : requestedSize);
+		head = 0;
+		peakRequest = 0;
+		if (mapped == nullptr) return false;
+		wait(fences[frame]);
+		return true;
+	}
+
+	// true when the last beginFrame() recreated the storage, which leaves every binding of the old buffer stale
+	bool recreated() const {
+		return grown;
+	}
+
+	Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16) {
+		const GLsizeiptr start = (head + alignment - 1) / alignment * alignment;
+		if (start + size > peakRequest) peakRequest = start + size;
+		if (mapped == nullptr) return Allocation();
+		if (start + size > regionSize) {
+			if (!overflowReported) std::cout << "WARNING::STREAM_BUFFER::FRAME_REGION_FULL, growing to fit next frame" << std::endl;
+			overflowReported = true;
+			return Allocation();
+		}
+		head = start + size;
+		Allocation allocation;
+		allocation.offset = (GLintptr)frame * regionSize + start;
+		allocation.data = mapped + allocation.offset;
+		allocation.size = size;
+		return allocation;
+	}
+
+	// slice usable with glBindBufferRange(GL_UNIFORM_BUFFER, ...)
+	Allocation allocateUniform(GLsizeiptr size) {
+		return allocate(size, uniformAlignment);
+	}
+
+	template <typename T>
+	Allocation writeUniform(const T& value) {
+		Allocation allocation = allocateUniform(sizeof(T));
+		if (allocation) std::memcpy(allocation.data, &value, sizeof(T));
+		return allocation;
+	}
+
+	// fences everything submitted this frame and moves on to the next region
+	void endFrame() {
+		if (fences[frame]) glDeleteSync(fences[frame]);
+		fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		frame = (frame + 1) % FRAMES_IN_FLIGHT;
+	}
+
+	// frames that had to wait for the GPU to release their region since the last call
+	unsigned int stalledFrames() {
+		const unsigned int count = stalls;
+		stalls = 0;
+		return count;
+	}
+
+	~StreamBuffer() {
+		for (GLsync& fence : fences) {
+			if (fence) glDeleteSync(fence);
+			fence = 0;
+		}
+		destroy();
+	}
+
+private:
+	char* mapped = nullptr;
+	GLsizeiptr regionSize = 0;
+	GLsizeiptr head = 0;
+	GLsizeiptr peakRequest = 0;
+	GLsizeiptr uniformAlignment = 256;
+	unsigned int frame = 0;
+	unsigned int stalls = 0;
+	GLsizeiptr requestedSize = 0;
+	bool overflowReported = false;
+	bool mapFailureReported = false;
+	bool grown = false;
+	GLsync fences[FRAMES_IN_FLIGHT] = {};
+
+	void create(GLsizeiptr frameSize) {
+		// whole pages per region keep every region start aligned for any binding
+		regionSize = (frameSize + 4095) / 4096 * 4096;
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &ID);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+		glBufferStorage(GL_COPY_WRITE_BUFFER, regionSize * FRAMES_IN_FLIGHT, NULL, flags);
+		mapped = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize * FRAMES_IN_FLIGHT, flags);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		requestedSize = frameSize;
+		head = 0;
+		overflowReported = false;
+		// without persistent mapping, or out of memory for a large region, there is nothing to write into
+		if (mapped == nullptr) {
+			if (!mapFailureReported) std::cout << "ERROR::STREAM_BUFFER::MAP_FAILED: " << regionSize * FRAMES_IN_FLIGHT << " bytes, frames are skipped" << std::endl;
+			mapFailureReported = true;
+			glDeleteBuffers(1, &ID);
+			ID = 0;
+			regionSize = 0;
+			return;
+		}
+		mapFailureReported = false;
+	}
+
+	void destroy() {
+		if (ID == 0) return;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &ID);
+		ID = 0;
+		mapped = nullptr;
+	}
+
+	void wait(GLsync& fence) {
+		if (!fence) return;
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			stalls++;
+			do {
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			} while (result == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync(fence);
+		fence = 0;
+	}
+};
+
+#endif
@@ -0,0 +1,213 @@
+#pragma once
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "job_system.h"
+
+// parent/child transforms in flat arrays sorted by depth, so every parent comes before its children and one
+// front-to-back pass turns local matrices into world matrices. Only nodes whose local matrix changed, and
+// their descendants, are recomputed; when nothing changed update() returns at once, so static nodes cost
+// nothing per frame. Nodes are addressed by ids that stay stable while the arrays are re-sorted
+class TransformHierarchy {
+public:
+	static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+	struct Stats {
+		double milliseconds = 0;
+		size_t updated = 0;
+	};
+
+	uint32_t add(const glm::mat4& local, uint32_t parent = NONE) {
+		uint32_t id;
+		if (!freeIds.empty()) {
+			id = freeIds.back();
+			freeIds.pop_back();
+		}
+		else {
+			id = (uint32_t)slotOf.size();
+			slotOf.push_back(NONE);
+		}
+		const uint32_t parentSlot = parent == NONE ? NONE : slotOf[parent];
+		const uint32_t depth = parentSlot == NONE ? 0 : depths[parentSlot] + 1;
+		if (!depths.empty() && depth < depths.back()) unsorted = true;
+
+		const uint32_t slot = (uint32_t)slotIds.size();
+		slotOf[id] = slot;
+		slotIds.push_back(id);
+		parents.push_back(parentSlot);
+		depths.push_back(depth);
+		locals.push_back(local);
+		worlds.push_back(local);
+		dirty.push_back(1);
+		removed.push_back(0);
+		firstDirty = std::min(firstDirty, slot);
+		return id;
+	}
+
+	// drops a node and everything below it; their ids are reused by later add() calls
+	void remove(uint32_t id) {
+		if (unsorted) sortByDepth();
+		const uint32_t slot = slotOf[id];
+		removed[slot] = 1;
+		for (size_t s = slot + 1; s < slotIds.size(); s++) {
+			if (parents[s] != NONE && removed[parents[s]]) removed[s] = 1;
+		}
+		unsorted = true;
+	}
+
+	void setLocal(uint32_t id, const glm::mat4& local) {
+		const uint32_t slot = slotOf[id];
+		locals[slot] = local;
+		dirty[slot] = 1;
+		firstDirty = std::min(firstDirty, slot);
+	}
+
+	const glm::mat4& local(uint32_t id) const {
+		return locals[slotOf[id]];
+	}
+
+	// as of the last update()
+	const glm::mat4& world(uint32_t id) const {
+		return worlds[slotOf[id]];
+	}
+
+	uint32_t parent(uint32_t id) const {
+		const uint32_t parentSlot = parents[slotOf[id]];
+		return parentSlot == NONE ? NONE : slotIds[parentSlot];
+	}
+
+	// ids whose world matrix was recomputed by the last update()
+	const std::vector<uint32_t>& changed() const {
+		return changedIds;
+	}
+
+	// one level at a time, front to back; nodes of one level only read their parents' finished world
+	// matrices, so large levels are split across the job system's threads
+	void update(JobSystem* jobs = nullptr) {
+		const auto begin = std::chrono::steady_clock::now();
+		if (unsorted) sortByDepth();
+		changedIds.clear();
+		stats = Stats();
+		if (firstDirty == NONE) return;
+
+		size_t levelBegin = firstDirty;
+		while (levelBegin < slotIds.size()) {
+			const uint32_t depth = depths[levelBegin];
+			size_t levelEnd = levelBegin;
+			while (levelEnd < slotIds.size() && depths[levelEnd] == depth) levelEnd++;
+			if (jobs != nullptr && levelEnd - levelBegin >= PARALLEL_GRAIN * 2) {
+				jobs->parallelFor(levelEnd - levelBegin, PARALLEL_GRAIN, [this, levelBegin](size_t begin, size_t end) { updateRange(levelBegin + begin, levelBegin + end); });
+			}
+			else updateRange(levelBegin, levelEnd);
+			levelBegin = levelEnd;
+		}
+
+		for (size_t slot = firstDirty; slot < slotIds.size(); slot++) {
+			if (!dirty[slot]) continue;
+			changedIds.push_back(slotIds[slot]);
+			dirty[slot] = 0;
+		}
+		firstDirty = NONE;
+		stats.updated = changedIds.size();
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	}
+
+	size_t size() const {
+		return slotIds.size();
+	}
+
+	const Stats& statistics() const {
+		return stats;
+	}
+
+private:
+	static constexpr size_t PARALLEL_GRAIN = 8192;
+
+	// per slot, sorted by depth
+	std::vector<uint32_t> slotIds;
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> depths;
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+	std::vector<uint8_t> dirty;
+	std::vector<uint8_t> removed;
+
+	// per id
+	std::vector<uint32_t> slotOf;
+	std::vector<uint32_t> freeIds;
+
+	std::vector<uint32_t> changedIds;
+	uint32_t firstDirty = NONE;
+	bool unsorted = false;
+	Stats stats;
+
+	void updateRange(size_t begin, size_t end) {
+		for (size_t slot = begin; slot < end; slot++) {
+			const uint32_t parentSlot = parents[slot];
+			if (parentSlot == NONE) {
+				if (dirty[slot]) worlds[slot] = locals[slot];
+			}
+			else if (dirty[slot] || dirty[parentSlot]) {
+				worlds[slot] = worlds[parentSlot] * locals[slot];
+				dirty[slot] = 1;
+			}
+		}
+	}
+
+	// stable counting sort by depth that also compacts removed nodes away; the sort only moves nodes, their
+	// world matrices stay valid
+	void sortByDepth() {
+		uint32_t maxDepth = 0;
+		for (uint32_t depth : depths) maxDepth = std::max(maxDepth, depth);
+		std::vector<size_t> levelStart(maxDepth + 2, 0);
+		for (size_t slot = 0; slot < slotIds.size(); slot++) {
+			if (!removed[slot]) levelStart[depths[slot] + 1]++;
+		}
+		for (uint32_t depth = 0; depth <= maxDepth; depth++) levelStart[depth + 1] += levelStart[depth];
+
+		const size_t count = levelStart[maxDepth + 1];
+		std::vector<uint32_t> newSlot(slotIds.size(), NONE);
+		for (size_t slot = 0; slot < slotIds.size(); slot++) {
+			if (!removed[slot]) newSlot[slot] = (uint32_t)levelStart[depths[slot]]++;
+		}
+
+		std::vector<uint32_t> sortedIds(count), sortedParents(count), sortedDepths(count);
+		std::vector<glm::mat4> sortedLocals(count), sortedWorlds(count);
+		std::vector<uint8_t> sortedDirty(count);
+		uint32_t sortedFirstDirty = NONE;
+		for (size_t slot = 0; slot < slotIds.size(); slot++) {
+			const uint32_t target = newSlot[slot];
+			if (target == NONE) {
+				slotOf[slotIds[slot]] = NONE;
+				freeIds.push_back(slotIds[slot]);
+				continue;
+			}
+			sortedIds[target] = slotIds[slot];
+			sortedParents[target] = parents[slot] == NONE ? NONE : newSlot[parents[slot]];
+			sortedDepths[target] = depths[slot];
+			sortedLocals[target] = locals[slot];
+			sortedWorlds[target] = worlds[slot];
+			sortedDirty[target] = dirty[slot];
+			if (dirty[slot]) sortedFirstDirty = std::min(sortedFirstDirty, target);
+			slotOf[slotIds[slot]] = target;
+		}
+		slotIds.swap(sortedIds);
+		parents.swap(sortedParents);
+		depths.swap(sortedDepths);
+		locals.swap(sortedLocals);
+		worlds.swap(sortedWorlds);
+		dirty.swap(sortedDirty);
+		removed.assign(count, 0);
+		firstDirty = sortedFirstDirty;
+		unsorted = false;
+	}
+};
+
+#endif
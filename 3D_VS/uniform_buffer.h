@@ -0,0 +1,51 @@
+#pragma once
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+
+#include "camera.h"
+#include "shader_handler.h"
+#include "stream_buffer.h"
+
+// std140 mirror of the Camera block declared in the vertex shaders
+struct CameraBlock {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec4 position;
+};
+static_assert(sizeof(CameraBlock) == 3 * 64 + 16, "CameraBlock must match the std140 layout");
+
+// per-frame camera data, written once into the stream buffer and shared by every program through CAMERA_BLOCK_BINDING
+class CameraUniformBuffer {
+public:
+	CameraUniformBuffer() {
+		std::memset(&block, 0, sizeof(block));
+	}
+
+	// the camera only rebuilds its matrices when it moved or its projection changed
+	void update(Camera& camera, float aspect, StreamBuffer& stream) {
+		camera.SetAspect(aspect);
+		block.view = camera.GetViewMatrix();
+		block.projection = camera.GetProjectionMatrix();
+		block.viewProjection = camera.GetViewProjectionMatrix();
+		block.position = glm::vec4(camera.GetPosition(), 1.f);
+
+		const auto slice = stream.writeUniform(block);
+		if (slice) glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, stream.ID, slice.offset, slice.size);
+	}
+
+	const CameraBlock& data() const {
+		return block;
+	}
+
+private:
+	CameraBlock block;
+};
+
+#endif
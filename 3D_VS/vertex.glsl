@@ -1,14 +0,0 @@
-#version 450 core
-
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aColor;
-out vec3 ourColor;
-
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 transform;
-
-void main() {
-    gl_Position = projection * view * transform * vec4(aPos, 1.0);
-    ourColor = aColor;
-};
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// shader input locations shared by every mesh layout
+enum VertexAttribute : uint32_t {
+	VERTEX_POSITION = 0,
+	VERTEX_COLOR = 1,
+	VERTEX_NORMAL = 2
+};
+
+// storage formats an attribute can be packed into; every format is a multiple of 4 bytes so interleaved
+// attributes stay naturally aligned
+enum class VertexFormat : uint32_t {
+	Float3, // 12 bytes, exact
+	Half4, // 8 bytes, w = 1; ~3 significant digits, keep Float3 for positions far from the origin
+	UNorm8x4, // 4 bytes, colors in [0, 1]
+	SNorm10x3 // 4 bytes, unit vectors as GL_INT_2_10_10_10_REV
+};
+
+inline uint32_t vertexFormatSize(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::Float3: return 12;
+	case VertexFormat::Half4: return 8;
+	default: return 4;
+	}
+}
+
+// component count, GL type and normalization for glVertexAttribFormat
+inline void vertexFormatGL(VertexFormat format, GLint& components, GLenum& type, GLboolean& normalized) {
+	switch (format) {
+	case VertexFormat::Float3: components = 3; type = GL_FLOAT; normalized = GL_FALSE; break;
+	case VertexFormat::Half4: components = 4; type = GL_HALF_FLOAT; normalized = GL_FALSE; break;
+	case VertexFormat::UNorm8x4: components = 4; type = GL_UNSIGNED_BYTE; normalized = GL_TRUE; break;
+	case VertexFormat::SNorm10x3: components = 4; type = GL_INT_2_10_10_10_REV; normalized = GL_TRUE; break;
+	}
+}
+
+inline void packVertexAttribute(VertexFormat format, const glm::vec3& value, unsigned char* destination) {
+	switch (format) {
+	case VertexFormat::Float3:
+		std::memcpy(destination, &value.x, 12);
+		break;
+	case VertexFormat::Half4: {
+		const uint16_t half[4] = { glm::packHalf1x16(value.x), glm::packHalf1x16(value.y), glm::packHalf1x16(value.z), glm::packHalf1x16(1.f) };
+		std::memcpy(destination, half, 8);
+		break;
+	}
+	case VertexFormat::UNorm8x4: {
+		const uint32_t packed = glm::packUnorm4x8(glm::vec4(value, 1.f));
+		std::memcpy(destination, &packed, 4);
+		break;
+	}
+	case VertexFormat::SNorm10x3: {
+		const uint32_t packed = glm::packSnorm3x10_1x2(glm::vec4(value, 0.f));
+		std::memcpy(destination, &packed, 4);
+		break;
+	}
+	}
+}
+
+// which format each attribute is stored in and which vertex stream it lives in; attributes sharing a stream
+// are interleaved in the order they were added
+class VertexLayout {
+public:
+	struct Element {
+		VertexAttribute attribute;
+		VertexFormat format;
+		uint32_t stream;
+		uint32_t offset;
+	};
+
+	VertexLayout& add(VertexAttribute attribute, VertexFormat format, uint32_t stream = 0) {
+		Element element = { attribute, format, stream, 0 };
+		for (const auto& other : elements) {
+			if (other.stream == stream) element.offset += vertexFormatSize(other.format);
+		}
+		elements.push_back(element);
+		return *this;
+	}
+
+	// full precision, one interleaved stream; 36 bytes per vertex with normals
+	static VertexLayout floats() {
+		VertexLayout layout;
+		layout.add(VERTEX_POSITION, VertexFormat::Float3).add(VERTEX_COLOR, VertexFormat::Float3).add(VERTEX_NORMAL, VertexFormat::Float3);
+		return layout;
+	}
+
+	// half positions, 8-bit colors and 10-bit normals in one interleaved stream; 16 bytes per vertex with normals
+	static VertexLayout packed() {
+		VertexLayout layout;
+		layout.add(VERTEX_POSITION, VertexFormat::Half4).add(VERTEX_COLOR, VertexFormat::UNorm8x4).add(VERTEX_NORMAL, VertexFormat::SNorm10x3);
+		return layout;
+	}
+
+	// the same layout without one attribute, offsets recomputed
+	VertexLayout without(VertexAttribute attribute) const {
+		VertexLayout layout;
+		for (const auto& element : elements) {
+			if (element.attribute != attribute) layout.add(element.attribute, element.format, element.stream);
+		}
+		return layout;
+	}
+
+	const std::vector<Element>& attributes() const {
+		return elements;
+	}
+
+	uint32_t streamCount() const {
+		uint32_t count = 0;
+		for (const auto& element : elements) {
+			if (element.stream + 1 > count) count = element.stream + 1;
+		}
+		return count;
+	}
+
+	uint32_t stride(uint32_t stream) const {
+		uint32_t size = 0;
+		for (const auto& element : elements) {
+			if (element.stream == stream) size += vertexFormatSize(element.format);
+		}
+		return size;
+	}
+
+	uint32_t vertexSize() const {
+		uint32_t size = 0;
+		for (const auto& element : elements) size += vertexFormatSize(element.format);
+		return size;
+	}
+
+private:
+	std::vector<Element> elements;
+};
+
+#endif
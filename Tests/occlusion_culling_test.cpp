@@ -0,0 +1,157 @@
+// GL-free checks of the software occlusion culler on known scenes: a box occluder, a square ring and a single
+// triangle straight ahead of a camera at the origin looking down -z, and test boxes placed behind them, beside
+// them, across their silhouettes and through the ring's hole
+#include <glm/glm.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "occlusion_culling.h"
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::cout << "FAILED " << __FILE__ << ":" << __LINE__ << ": " << #condition << std::endl; \
+			failures++; \
+		} \
+	} while (0)
+
+// the same camera for every scene, with the buffer's 2:1 aspect
+static void beginScene(OcclusionBuffer& occlusion) {
+	const glm::mat4 projection = glm::perspective(glm::radians(45.f), 2.f, 0.1f, 100.f);
+	const glm::mat4 view = glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+	occlusion.begin(projection * view);
+}
+
+// 4x4x4 box occluder centered 10 units ahead; its silhouette is set by the front face at z = -8, so it covers
+// directions with |x| / -z and |y| / -z below 0.25
+static void drawOccluder(OcclusionBuffer& occlusion, JobSystem* jobs) {
+	beginScene(occlusion);
+	occlusion.addBoxOccluder(glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, -10.f)), glm::vec3(-2.f), glm::vec3(2.f));
+	occlusion.rasterize(jobs);
+}
+
+static void testVisibility(const OcclusionBuffer& occlusion) {
+	// small and large boxes fully behind the occluder, tested on a fine and on a coarse pyramid level
+	CHECK(!occlusion.isVisible(glm::vec3(0.f, 0.f, -20.f), glm::vec3(0.5f)));
+	CHECK(!occlusion.isVisible(glm::vec3(0.f, 0.f, -40.f), glm::vec3(3.f)));
+	// beside the occluder, and in front of it
+	CHECK(occlusion.isVisible(glm::vec3(6.f, 0.f, -20.f), glm::vec3(0.5f)));
+	CHECK(occlusion.isVisible(glm::vec3(0.f, 0.f, -5.f), glm::vec3(0.5f)));
+	// behind the occluder but reaching past its right and top edges
+	CHECK(occlusion.isVisible(glm::vec3(5.f, 0.f, -20.f), glm::vec3(0.5f)));
+	CHECK(occlusion.isVisible(glm::vec3(0.f, 5.f, -20.f), glm::vec3(0.5f)));
+	// crossing the near plane
+	CHECK(occlusion.isVisible(glm::vec3(0.f), glm::vec3(1.f)));
+	// a box about a pixel wide reaching a fifth of a pixel past the silhouette, into a pixel whose center the
+	// occluder covers
+	CHECK(occlusion.isVisible(glm::vec3(4.957f, 0.f, -20.f), glm::vec3(0.05f)));
+}
+
+// closed square ring facing the camera between z = -9.5 and z = -10.5: outer half size 4, a hole of half size 2
+// through the middle. Counter-clockwise seen from outside, with vertex 0..7 the front and 8..15 the back; the
+// first four of each are the outer corners, the last four the inner ones
+static void makeRing(std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices) {
+	const glm::vec2 corners[4] = { glm::vec2(-1.f, -1.f), glm::vec2(1.f, -1.f), glm::vec2(1.f, 1.f), glm::vec2(-1.f, 1.f) };
+	positions.clear();
+	for (float z : { -9.5f, -10.5f }) {
+		for (float size : { 4.f, 2.f }) {
+			for (const glm::vec2& corner : corners) positions.push_back(glm::vec3(corner.x * size, corner.y * size, z));
+		}
+	}
+	indices.clear();
+	const auto quad = [&](uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+		const uint32_t triangles[6] = { a, b, c, a, c, d };
+		indices.insert(indices.end(), triangles, triangles + 6);
+	};
+	for (uint32_t i = 0; i < 4; i++) {
+		const uint32_t j = (i + 1) % 4;
+		quad(i, j, 4 + j, 4 + i); // front, facing +z
+		quad(8 + j, 8 + i, 12 + i, 12 + j); // back, facing -z
+		quad(8 + i, 8 + j, j, i); // outside
+		quad(4 + i, 4 + j, 12 + j, 12 + i); // inside the hole
+	}
+}
+
+static void testRing(JobSystem& jobs) {
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices, adjacency;
+	makeRing(positions, indices);
+	OcclusionBuffer::buildAdjacency(indices.data(), indices.size(), adjacency);
+	CHECK(std::count(adjacency.begin(), adjacency.end(), OcclusionBuffer::NO_NEIGHBOR) == 0);
+
+	OcclusionBuffer occlusion;
+	beginScene(occlusion);
+	occlusion.addTriangles(glm::mat4(1.f), positions.data(), positions.size(), indices.data(), indices.size(), adjacency.data());
+	occlusion.rasterize(&jobs);
+	// behind the ring's right bar, and behind its top bar, far from both of its outlines
+	CHECK(!occlusion.isVisible(glm::vec3(6.f, 0.f, -20.f), glm::vec3(0.5f)));
+	CHECK(!occlusion.isVisible(glm::vec3(0.f, 6.f, -20.f), glm::vec3(0.5f)));
+	// seen through the hole, also when a larger box fills most of it
+	CHECK(occlusion.isVisible(glm::vec3(0.f, 0.f, -20.f), glm::vec3(0.5f)));
+	CHECK(occlusion.isVisible(glm::vec3(0.f, 0.f, -40.f), glm::vec3(4.f)));
+	// half behind the bar and half in the hole
+	CHECK(occlusion.isVisible(glm::vec3(3.8f, 0.f, -20.f), glm::vec3(0.5f)));
+	// outside the ring
+	CHECK(occlusion.isVisible(glm::vec3(12.f, 0.f, -20.f), glm::vec3(0.5f)));
+}
+
+// one large unconnected triangle through the non-indexed path, every edge of which is a silhouette
+static void testTriangle() {
+	const glm::vec3 triangle[3] = { glm::vec3(-6.f, -4.f, -10.f), glm::vec3(6.f, -4.f, -10.f), glm::vec3(0.f, 6.f, -10.f) };
+	OcclusionBuffer occlusion;
+	beginScene(occlusion);
+	occlusion.addTriangles(glm::mat4(1.f), triangle, 3);
+	occlusion.rasterize();
+	CHECK(occlusion.statistics().triangles == 1);
+	CHECK(!occlusion.isVisible(glm::vec3(0.f, 0.f, -20.f), glm::vec3(0.5f)));
+	// beside the slanted edge
+	CHECK(occlusion.isVisible(glm::vec3(8.f, 6.f, -20.f), glm::vec3(0.5f)));
+}
+
+static void testDepth(const OcclusionBuffer& occlusion) {
+	const std::vector<float>& depth = occlusion.depth();
+	const unsigned int width = occlusion.bufferWidth(), height = occlusion.bufferHeight();
+	// the occluder's front face covers the center, the corners stay at the far plane
+	CHECK(depth[(size_t)(height / 2) * width + width / 2] < 1.f);
+	CHECK(depth[0] == 1.f);
+	CHECK(depth[(size_t)height * width - 1] == 1.f);
+}
+
+static void testFilter(const OcclusionBuffer& occlusion) {
+	CullBounds bounds;
+	bounds.resize(3);
+	bounds.set(0, glm::vec3(0.f, 0.f, -20.f), glm::vec3(0.5f));
+	bounds.set(1, glm::vec3(6.f, 0.f, -20.f), glm::vec3(0.5f));
+	bounds.set(2, glm::vec3(5.f, 0.f, -20.f), glm::vec3(0.5f));
+	std::vector<uint32_t> visible = { 0, 1, 2 };
+	CHECK(occlusion.filter(bounds, visible) == 1);
+	CHECK(visible.size() == 2 && visible[0] == 1 && visible[1] == 2);
+}
+
+int main() {
+	OcclusionBuffer serial;
+	drawOccluder(serial, nullptr);
+	CHECK(serial.statistics().triangles > 0);
+	testVisibility(serial);
+	testDepth(serial);
+	testFilter(serial);
+
+	// rasterizing in bands on the job system has to produce the same buffer
+	JobSystem jobs(4);
+	OcclusionBuffer banded;
+	drawOccluder(banded, &jobs);
+	CHECK(banded.depth() == serial.depth());
+	testVisibility(banded);
+
+	testRing(jobs);
+	testTriangle();
+
+	if (failures == 0) std::cout << "occlusion culling: all checks passed" << std::endl;
+	return failures == 0 ? 0 : 1;
+}